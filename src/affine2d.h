@@ -0,0 +1,152 @@
+#pragma once
+
+#include "vec2f.h"
+
+#include <cmath>
+#include <numbers>
+#include <span>
+#include <cassert>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define MIRRAS_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MIRRAS_SSE2
+#endif
+
+namespace mirras
+{
+static_assert(sizeof(Vec2f) == 2 * sizeof(float), "Vec2f arrays are processed as packed floats");
+
+/*
+    2D affine transform, stored as the columns of a 2x3 matrix:
+
+        | xAxis.x  yAxis.x  offset.x |
+        | xAxis.y  yAxis.y  offset.y |
+
+    ... so that p' = xAxis * p.x + yAxis * p.y + offset
+*/
+struct Affine2D
+{
+    static Affine2D translation(Vec2f t)
+    {
+        return {{1.f, 0.f}, {0.f, 1.f}, t};
+    }
+
+    // Counterclockwise, in degrees
+    static Affine2D rotation(float angle, Vec2f center = {})
+    {
+        float rad = angle * std::numbers::pi_v<float> / 180.f;
+        float c = std::cos(rad);
+        float s = std::sin(rad);
+
+        Affine2D rot{{c, s}, {-s, c}, {}};
+        rot.offset = center - rot.applyLinear(center);
+
+        return rot;
+    }
+
+    static Affine2D scale(Vec2f factor, Vec2f center = {})
+    {
+        return {{factor.x, 0.f}, {0.f, factor.y}, center - Vec2f{center.x * factor.x, center.y * factor.y}};
+    }
+
+    Vec2f apply(Vec2f p) const
+    {
+        return applyLinear(p) + offset;
+    }
+
+    // Without the translation, for directions
+    Vec2f applyLinear(Vec2f p) const
+    {
+        return xAxis * p.x + yAxis * p.y;
+    }
+
+    // In place, with the batched kernel
+    void apply(std::span<Vec2f> vertices) const;
+
+    // The transform must not be degenerate (e.g. scaled by 0)
+    Affine2D inverse() const
+    {
+        float invDet = 1.f / (xAxis.x * yAxis.y - yAxis.x * xAxis.y);
+
+        Affine2D inv{Vec2f{yAxis.y, -xAxis.y} * invDet, Vec2f{-yAxis.x, xAxis.x} * invDet, {}};
+        inv.offset = Vec2f{} - inv.applyLinear(offset);
+
+        return inv;
+    }
+
+    Vec2f xAxis{1.f, 0.f};
+    Vec2f yAxis{0.f, 1.f};
+    Vec2f offset{};
+};
+
+// Composition, the rhs is applied first
+inline Affine2D operator* (const Affine2D& lhs, const Affine2D& rhs)
+{
+    return {lhs.applyLinear(rhs.xAxis), lhs.applyLinear(rhs.yAxis), lhs.apply(rhs.offset)};
+}
+
+// Transforms a contiguous array of vertices, both arrays must have the same size (and may be the same one)
+inline void transformVertices(std::span<const Vec2f> in, std::span<Vec2f> out, const Affine2D& transform)
+{
+    assert(in.size() == out.size());
+
+    const float* src = &in.data()->x;
+    float* dst = &out.data()->x;
+    size_t count = in.size() * 2; // Number of floats
+    size_t i = 0;
+
+    const auto& [xAxis, yAxis, offset] = transform;
+
+    // Vertices are interleaved (x, y, x, y...), so each one is split into (x, x) and (y, y), which are
+    // then multiplied by the columns of the matrix
+#if defined(MIRRAS_AVX2)
+    __m256 col0 = _mm256_setr_ps(xAxis.x, xAxis.y, xAxis.x, xAxis.y, xAxis.x, xAxis.y, xAxis.x, xAxis.y);
+    __m256 col1 = _mm256_setr_ps(yAxis.x, yAxis.y, yAxis.x, yAxis.y, yAxis.x, yAxis.y, yAxis.x, yAxis.y);
+    __m256 col2 = _mm256_setr_ps(offset.x, offset.y, offset.x, offset.y, offset.x, offset.y, offset.x, offset.y);
+
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 v  = _mm256_loadu_ps(src + i);
+        __m256 xx = _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 0, 0));
+        __m256 yy = _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 1, 1));
+
+    #if defined(__FMA__)
+        _mm256_storeu_ps(dst + i, _mm256_fmadd_ps(xx, col0, _mm256_fmadd_ps(yy, col1, col2)));
+    #else
+        _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_mul_ps(xx, col0), _mm256_add_ps(_mm256_mul_ps(yy, col1), col2)));
+    #endif
+    }
+#elif defined(MIRRAS_SSE2)
+    __m128 col0 = _mm_setr_ps(xAxis.x, xAxis.y, xAxis.x, xAxis.y);
+    __m128 col1 = _mm_setr_ps(yAxis.x, yAxis.y, yAxis.x, yAxis.y);
+    __m128 col2 = _mm_setr_ps(offset.x, offset.y, offset.x, offset.y);
+
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 v  = _mm_loadu_ps(src + i);
+        __m128 xx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+        __m128 yy = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(xx, col0), _mm_add_ps(_mm_mul_ps(yy, col1), col2)));
+    }
+#endif
+
+    // Scalar fallback, also takes care of the remaining vertices
+    for(; i < count; i += 2)
+    {
+        float x = src[i], y = src[i + 1];
+
+        dst[i]     = x * xAxis.x + (y * yAxis.x + offset.x);
+        dst[i + 1] = x * xAxis.y + (y * yAxis.y + offset.y);
+    }
+}
+
+inline void Affine2D::apply(std::span<Vec2f> vertices) const
+{
+    transformVertices(vertices, vertices, *this);
+}
+
+} // namespace mirras
\ No newline at end of file
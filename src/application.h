@@ -1,6 +1,8 @@
 #pragma once
 
 #include "graphics.h"
+#include "imageExport.h"
+#include "redrawTracker.h"
 
 namespace mirras
 {
@@ -24,10 +26,22 @@ public:
 
         initGlad();
         initImGui(window);
+
+        // What is shown has to be drawn again, without any input reaching ImGui
+        auto redraw = [](auto&&...) { g_RedrawTracker.requestRedraw(); };
+
+        window.refreshEvent.setCallback(redraw);
+        window.framebufferSizeEvent.setCallback(redraw);
+        window.iconifyEvent.setCallback(redraw);
+        window.maximizeEvent.setCallback(redraw);
+        window.contentScaleEvent.setCallback(redraw);
     }
 
     ~App()
     {
+        // The export asks for a redraw once done, which needs GLFW to still be there
+        g_ImageExportJob.wait();
+
         shutdownImGui();
         glfw::terminate();
     }
@@ -36,7 +50,10 @@ public:
     {
         while(!window.shouldClose())
         {
-            glfw::pollEvents();
+            g_RedrawTracker.waitEvents();
+
+            if(!g_RedrawTracker.shouldDrawFrame())
+                continue;
 
             auto[width, height] = window.getFramebufferSize();
             glViewport(0, 0, width, height);
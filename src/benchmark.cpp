@@ -0,0 +1,982 @@
+#include "benchmark.h"
+
+#include "objects.h"
+#include "viewportTransform.h"
+#include "representation.h"
+#include "workerPool.h"
+#include "clippingAlgorithms.h"
+#include "graphics.h"
+#include "drawBackend.h"
+#include "rasterizer.h"
+
+#include <glm/ext/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace mirras
+{
+static constexpr size_t vertexCount = 10'000'000;
+static constexpr int runsPerBenchmark = 5;
+
+// Best time out of a few runs, in seconds
+template<typename Func>
+static double bestTimeOf(Func&& func)
+{
+    double best = 1e30;
+
+    for(int i = 0; i < runsPerBenchmark; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        best = std::min(best, elapsed.count());
+    }
+
+    return best;
+}
+
+static const char* simdPathName()
+{
+#if defined(MIRRAS_AVX2)
+    return "AVX2";
+#elif defined(MIRRAS_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+static std::vector<Vec2f> randomVertices(size_t count)
+{
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> dist{-100.f, 100.f};
+
+    std::vector<Vec2f> vertices(count);
+
+    for(auto& v : vertices)
+        v = {dist(rng), dist(rng)};
+
+    return vertices;
+}
+
+static void printThroughput(const char* name, size_t count, double seconds)
+{
+    std::printf("  %-28s %10.2f ms %12.1f M vertices/s\n", name, seconds * 1e3, count / seconds * 1e-6);
+}
+
+// Each benchmark also checks its results, this reports a check that didn't pass and returns whether it did
+static bool reportCheck(bool hasPassed, const char* what)
+{
+    if(!hasPassed)
+        std::printf("  FAILED: %s\n\n", what);
+
+    return hasPassed;
+}
+
+// How each vertex used to be mapped, recomputing the window/viewport ratios every time
+static Vec2f toViewportPerVertex(Vec2f p, Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+{
+    float vX = (p.x - wmin.x) / (wmax.x - wmin.x) * (vmax.x) + vmin.x;
+    float vY = (1 - (p.y - wmin.y) / (wmax.y - wmin.y)) * (vmax.y) + vmin.y;
+
+    return {vX, vY};
+}
+
+static bool benchmarkViewportMapping()
+{
+    std::printf("Window to viewport mapping, %zu vertices\n", vertexCount);
+
+    auto vertices = randomVertices(vertexCount);
+    std::vector<Vec2f> perVertexResult(vertexCount), batchedResult(vertexCount);
+
+    Vec2f wmin{-50.f, -50.f}, wmax{50.f, 50.f};
+    Vec2f vmin{10.f, 10.f}, vmax{620.f, 460.f};
+
+    double perVertexTime = bestTimeOf([&]
+    {
+        for(size_t i = 0; i < vertices.size(); ++i)
+            perVertexResult[i] = toViewportPerVertex(vertices[i], wmin, wmax, vmin, vmax);
+    });
+
+    double batchedTime = bestTimeOf([&]
+    {
+        transformVertices(vertices, batchedResult, windowToViewport(wmin, wmax, vmin, vmax));
+    });
+
+    float maxError{};
+
+    for(size_t i = 0; i < vertexCount; ++i)
+    {
+        maxError = std::max(maxError, std::abs(perVertexResult[i].x - batchedResult[i].x));
+        maxError = std::max(maxError, std::abs(perVertexResult[i].y - batchedResult[i].y));
+    }
+
+    printThroughput("per vertex", vertexCount, perVertexTime);
+    printThroughput(simdPathName(), vertexCount, batchedTime);
+    std::printf("  speedup: %.2fx, max difference: %g px\n\n", perVertexTime / batchedTime, maxError);
+
+    return reportCheck(maxError <= 1e-3f, "the batched mapping is off by more than a thousandth of a pixel");
+}
+
+// A rotation around a point composed with a scale, built the way the object controls used to, with 4x4 matrices
+static bool benchmarkAffineTransform()
+{
+    std::printf("Rotation + scale around a center, %zu vertices\n", vertexCount);
+
+    auto vertices = randomVertices(vertexCount);
+    std::vector<Vec2f> glmResult(vertexCount), affineResult(vertexCount);
+
+    Vec2f center{12.f, -7.f};
+    float angle = 30.f, scaleFactor = 1.5f;
+
+    auto t1  = glm::translate(glm::mat4(1.f), glm::vec3(-center.x, -center.y, 0.f));
+    auto rot = glm::rotate(glm::mat4(1.f), glm::radians(angle), glm::vec3(0.f, 0.f, 1.f));
+    auto s   = glm::scale(glm::mat4(1.f), glm::vec3(scaleFactor, scaleFactor, 0.f));
+    auto t2  = glm::translate(glm::mat4(1.f), glm::vec3(center.x, center.y, 0.f));
+    glm::mat4 matrix = t2 * s * rot * t1;
+
+    Affine2D affine = Affine2D::scale({scaleFactor, scaleFactor}, center) * Affine2D::rotation(angle, center);
+
+    double glmTime = bestTimeOf([&]
+    {
+        for(size_t i = 0; i < vertices.size(); ++i)
+        {
+            auto result = matrix * glm::vec4(vertices[i].x, vertices[i].y, 0.f, 1.f);
+            glmResult[i] = {result.x, result.y};
+        }
+    });
+
+    double affineTime = bestTimeOf([&]
+    {
+        transformVertices(vertices, affineResult, affine);
+    });
+
+    float maxError{};
+
+    for(size_t i = 0; i < vertexCount; ++i)
+    {
+        maxError = std::max(maxError, std::abs(glmResult[i].x - affineResult[i].x));
+        maxError = std::max(maxError, std::abs(glmResult[i].y - affineResult[i].y));
+    }
+
+    printThroughput("glm::mat4 per vertex", vertexCount, glmTime);
+    printThroughput("Affine2D batched", vertexCount, affineTime);
+    std::printf("  speedup: %.2fx, max difference: %g\n", glmTime / affineTime, maxError);
+
+    // What the object controls pay for every transform requested, rotations only so that the result stays finite
+    constexpr int compositions = 1'000'000;
+    glm::mat4 glmRotation = t2 * rot * t1;
+    Affine2D affineRotation = Affine2D::rotation(angle, center);
+
+    glm::mat4 glmComposed{1.f};
+    Affine2D affineComposed;
+
+    double glmComposeTime = bestTimeOf([&]
+    {
+        for(int i = 0; i < compositions; ++i)
+            glmComposed = glmComposed * glmRotation;
+    });
+
+    double affineComposeTime = bestTimeOf([&]
+    {
+        for(int i = 0; i < compositions; ++i)
+            affineComposed = affineComposed * affineRotation;
+    });
+
+    std::printf("  compose x%d: glm::mat4 %.2f ms, Affine2D %.2f ms (%g, %g)\n\n", compositions,
+                glmComposeTime * 1e3, affineComposeTime * 1e3, glmComposed[3][0], affineComposed.offset.x);
+
+    return reportCheck(maxError <= 1e-3f, "Affine2D is off from glm::mat4 by more than a thousandth");
+}
+
+static World randomWorld(size_t objectCount)
+{
+    auto vertices = randomVertices(objectCount * 2);
+    std::vector<Vec2f> polyVertices(6);
+
+    World world;
+    world.reserve(objectCount / 2, objectCount / 4, objectCount / 4, objectCount / 4 * polyVertices.size());
+
+    for(size_t i = 0; i < objectCount; ++i)
+    {
+        Vec2f p = vertices[i * 2], q = vertices[i * 2 + 1];
+
+        if(i % 4 < 2)
+            world.add(Point{p});
+        else
+        if(i % 4 == 2)
+            world.add(LineSegment{p, q});
+        else
+        {
+            for(size_t j = 0; j < polyVertices.size(); ++j)
+                polyVertices[j] = p + Affine2D::rotation(60.f * j).apply({1.f, 0.f});
+
+            world.add(polyVertices);
+        }
+    }
+
+    return world;
+}
+
+static bool benchmarkParallelTransform()
+{
+    constexpr size_t objectCount = 2'000'000;
+
+    std::printf("Transforming the whole world, %zu objects, threads: %zu\n", objectCount, g_WorkerPool.threadCount());
+
+    World serialWorld = randomWorld(objectCount);
+    World parallelWorld = randomWorld(objectCount);
+
+    WorkerPool serialPool{0};
+    auto transform = Affine2D::rotation(0.5f, {3.f, 4.f});
+
+    double serialTime = bestTimeOf([&] { serialWorld.applyTransform(transform, serialPool); });
+    double parallelTime = bestTimeOf([&] { parallelWorld.applyTransform(transform, g_WorkerPool); });
+
+    bool isIdentical = std::ranges::equal(serialWorld.points.positions, parallelWorld.points.positions)
+                    && std::ranges::equal(serialWorld.lines.p0, parallelWorld.lines.p0)
+                    && std::ranges::equal(serialWorld.lines.p1, parallelWorld.lines.p1)
+                    && std::ranges::equal(serialWorld.polygons.transforms, parallelWorld.polygons.transforms, [](const auto& a, const auto& b)
+                       {
+                           return a.xAxis == b.xAxis && a.yAxis == b.yAxis && a.offset == b.offset;
+                       });
+
+    std::printf("  %-28s %10.2f ms\n", "serial", serialTime * 1e3);
+    std::printf("  %-28s %10.2f ms\n", "worker pool", parallelTime * 1e3);
+    std::printf("  speedup: %.2fx, identical to the serial result: %s\n\n", serialTime / parallelTime, isIdentical ? "yes" : "NO");
+
+    return reportCheck(isIdentical, "the world transformed on the pool differs from the serial one");
+}
+
+// Clipping all the visible polygons again, as when the window moves, with concave ones crossing its borders
+static bool benchmarkParallelClipping()
+{
+    constexpr size_t polygonCount = 200'000;
+
+    std::printf("Clipping the visible polygons again, %zu polygons, threads: %zu\n", polygonCount, g_WorkerPool.threadCount());
+
+    // Stars, so that the ones on the window borders go through Weiler Atherton
+    auto centers = randomVertices(polygonCount);
+    std::vector<Vec2f> star(10);
+
+    World serialWorld, parallelWorld;
+
+    for(auto c : centers)
+    {
+        for(size_t j = 0; j < star.size(); ++j)
+            star[j] = c + Affine2D::rotation(36.f * j).apply({j % 2 ? 4.f : 10.f, 0.f});
+
+        serialWorld.add(star);
+        parallelWorld.add(star);
+    }
+
+    Window win;
+    win.wmin = {-50.f, -50.f};
+    win.wmax = {50.f, 50.f};
+    win.rotate(20.f);
+
+    Viewport vp;
+    vp.setSize(800.f, 800.f);
+
+    ClippingOptions options{.enableWeilerAtherton = true};
+    WorkerPool serialPool{0};
+
+    for(auto* world : {&serialWorld, &parallelWorld})
+    {
+        world->updateVisibleObjects(win.getWorldBounds());
+        world->updateViewportCoord(win, vp);
+    }
+
+    // Moving the window, even by nothing, makes every polygon be clipped again
+    double serialTime = bestTimeOf([&]
+    {
+        win.translate({});
+        serialWorld.updateClippedGeometry(win, vp, options, nullptr, serialPool);
+    });
+
+    double parallelTime = bestTimeOf([&]
+    {
+        win.translate({});
+        parallelWorld.updateClippedGeometry(win, vp, options, nullptr, g_WorkerPool);
+    });
+
+    const auto& serial = serialWorld.polygons;
+    const auto& parallel = parallelWorld.polygons;
+
+    auto isSameRange = [](VertexRange a, VertexRange b) { return a.first == b.first && a.count == b.count; };
+
+    bool isIdentical = std::ranges::equal(serial.clippedVertices, parallel.clippedVertices)
+                    && std::ranges::equal(serial.vClippedVertices, parallel.vClippedVertices)
+                    && std::ranges::equal(serial.clippedSubPolygons, parallel.clippedSubPolygons, isSameRange)
+                    && std::ranges::equal(serial.clippedPolygons, parallel.clippedPolygons, isSameRange);
+
+    std::printf("  %-28s %10.2f ms\n", "serial", serialTime * 1e3);
+    std::printf("  %-28s %10.2f ms\n", "worker pool", parallelTime * 1e3);
+    std::printf("  speedup: %.2fx, visible: %zu, sub polygons: %zu, identical to the serial result: %s\n\n", serialTime / parallelTime,
+                serialWorld.getVisibleObjects().size(), serial.clippedSubPolygons.size(), isIdentical ? "yes" : "NO");
+
+    return reportCheck(isIdentical, "the polygons clipped on the pool differ from the serial ones");
+}
+
+static void printSegmentThroughput(const char* name, size_t count, double seconds)
+{
+    std::printf("  %-28s %10.2f ms %12.1f M segments/s\n", name, seconds * 1e3, count / seconds * 1e-6);
+}
+
+// Also checks the batched version against the scalar one, segment by segment
+static bool benchmarkLiangBarsky()
+{
+    constexpr size_t segmentCount = vertexCount / 2;
+
+    std::printf("Liang-Barsky clipping, %zu segments\n", segmentCount);
+
+    auto vertices = randomVertices(segmentCount * 2);
+    std::span<const Vec2f> p0{vertices.data(), segmentCount}, p1{vertices.data() + segmentCount, segmentCount};
+
+    Window win;
+    win.wmin = {-50.f, -50.f};
+    win.wmax = {50.f, 50.f};
+
+    std::vector<std::optional<LineSeg>> scalarResult(segmentCount);
+    std::vector<Vec2f> clippedP0(segmentCount), clippedP1(segmentCount);
+    std::vector<uint8_t> isVisible(segmentCount);
+
+    double scalarTime = bestTimeOf([&]
+    {
+        for(size_t i = 0; i < segmentCount; ++i)
+            scalarResult[i] = liangBarsky(win, LineSeg{p0[i], p1[i]});
+    });
+
+    size_t visibleCount{};
+
+    double batchedTime = bestTimeOf([&]
+    {
+        visibleCount = liangBarsky(win, p0, p1, clippedP0, clippedP1, isVisible);
+    });
+
+    size_t mismatches{};
+    float maxError{};
+
+    for(size_t i = 0; i < segmentCount; ++i)
+    {
+        if(scalarResult[i].has_value() != (bool) isVisible[i])
+        {
+            ++mismatches;
+            continue;
+        }
+
+        if(!scalarResult[i])
+            continue;
+
+        maxError = std::max({maxError, std::abs(scalarResult[i]->p0.x - clippedP0[i].x), std::abs(scalarResult[i]->p0.y - clippedP0[i].y),
+                                       std::abs(scalarResult[i]->p1.x - clippedP1[i].x), std::abs(scalarResult[i]->p1.y - clippedP1[i].y)});
+    }
+
+    printSegmentThroughput("scalar", segmentCount, scalarTime);
+    printSegmentThroughput("batched", segmentCount, batchedTime);
+    std::printf("  speedup: %.2fx, visible: %zu, visibility mismatches: %zu, max difference: %g\n\n",
+                scalarTime / batchedTime, visibleCount, mismatches, maxError);
+
+    return reportCheck(mismatches == 0 && maxError <= 1e-3f, "the batched Liang-Barsky differs from the scalar one");
+}
+
+static bool benchmarkCohenSutherland()
+{
+    constexpr size_t segmentCount = vertexCount / 2;
+
+    std::printf("Cohen Sutherland clipping, %zu segments\n", segmentCount);
+
+    // Short segments over a window covering most of the scene, as in a typical frame, so most are trivially settled
+    auto vertices = randomVertices(segmentCount);
+    auto offsets = randomVertices(segmentCount);
+    std::vector<Vec2f> p0(vertices), p1(segmentCount);
+
+    for(size_t i = 0; i < segmentCount; ++i)
+        p1[i] = p0[i] + offsets[i] * 0.02f;
+
+    Window win;
+    win.wmin = {-80.f, -80.f};
+    win.wmax = {80.f, 80.f};
+
+    std::vector<std::optional<LineSeg>> scalarResult(segmentCount);
+    std::vector<Vec2f> clippedP0(segmentCount), clippedP1(segmentCount);
+    std::vector<uint8_t> isVisible(segmentCount);
+
+    double scalarTime = bestTimeOf([&]
+    {
+        for(size_t i = 0; i < segmentCount; ++i)
+            scalarResult[i] = cohenSutherland(win, LineSeg{p0[i], p1[i]});
+    });
+
+    LineClippingStats stats;
+
+    double batchedTime = bestTimeOf([&]
+    {
+        stats = cohenSutherland(win, p0, p1, clippedP0, clippedP1, isVisible);
+    });
+
+    size_t mismatches{};
+
+    for(size_t i = 0; i < segmentCount; ++i)
+    {
+        if(scalarResult[i].has_value() != (bool) isVisible[i])
+            ++mismatches;
+        else
+        if(scalarResult[i] && (scalarResult[i]->p0 != clippedP0[i] || scalarResult[i]->p1 != clippedP1[i]))
+            ++mismatches;
+    }
+
+    printSegmentThroughput("scalar", segmentCount, scalarTime);
+    printSegmentThroughput("batched", segmentCount, batchedTime);
+    std::printf("  speedup: %.2fx, mismatches: %zu\n", scalarTime / batchedTime, mismatches);
+    std::printf("  trivially accepted: %zu, trivially rejected: %zu, clipped: %zu\n\n",
+                stats.trivialAccepts, stats.trivialRejects, stats.clipped);
+
+    return reportCheck(mismatches == 0, "the batched Cohen Sutherland differs from the scalar one");
+}
+
+/*
+    A rotated window, clipped either by taking the segments to window coordinates and running Liang Barsky, or by
+    running Cyrus Beck against the window where it is in the world. Also checks that both agree, and that the batched
+    Cyrus Beck matches the scalar one
+*/
+static bool benchmarkCyrusBeck()
+{
+    constexpr size_t segmentCount = vertexCount / 2;
+
+    std::printf("Clipping against a rotated window, %zu segments\n", segmentCount);
+
+    auto vertices = randomVertices(segmentCount * 2);
+    std::span<const Vec2f> p0{vertices.data(), segmentCount}, p1{vertices.data() + segmentCount, segmentCount};
+
+    Window win;
+    win.wmin = {-50.f, -50.f};
+    win.wmax = {50.f, 50.f};
+    win.rotate(30.f);
+
+    ConvexRegion region{win.getWorldCorners()};
+
+    std::vector<Vec2f> windowP0(segmentCount), windowP1(segmentCount);
+    std::vector<Vec2f> clippedP0(segmentCount), clippedP1(segmentCount);
+    std::vector<uint8_t> isVisible(segmentCount), isVisibleInWindow(segmentCount);
+
+    double liangTime = bestTimeOf([&]
+    {
+        transformVertices(p0, windowP0, win.view);
+        transformVertices(p1, windowP1, win.view);
+        liangBarsky(win, windowP0, windowP1, windowP0, windowP1, isVisibleInWindow);
+    });
+
+    size_t visibleCount{};
+
+    double cyrusTime = bestTimeOf([&]
+    {
+        visibleCount = cyrusBeck(region, p0, p1, clippedP0, clippedP1, isVisible);
+    });
+
+    size_t mismatches{}, scalarMismatches{};
+    float maxError{}, maxScalarError{};
+
+    for(size_t i = 0; i < segmentCount; ++i)
+    {
+        auto scalarResult = cyrusBeck(region, LineSeg{p0[i], p1[i]});
+
+        // With FMA, the compiler may fuse the operations of the scalar version differently from the batched one
+        if(scalarResult.has_value() != (bool) isVisible[i])
+            ++scalarMismatches;
+        else
+        if(scalarResult)
+            maxScalarError = std::max({maxScalarError, std::abs(scalarResult->p0.x - clippedP0[i].x), std::abs(scalarResult->p0.y - clippedP0[i].y),
+                                                       std::abs(scalarResult->p1.x - clippedP1[i].x), std::abs(scalarResult->p1.y - clippedP1[i].y)});
+
+        // Segments only grazing a corner may go either way
+        if(isVisible[i] != isVisibleInWindow[i])
+        {
+            ++mismatches;
+            continue;
+        }
+
+        if(!isVisible[i])
+            continue;
+
+        Vec2f c0 = win.view.apply(clippedP0[i]), c1 = win.view.apply(clippedP1[i]);
+
+        maxError = std::max({maxError, std::abs(c0.x - windowP0[i].x), std::abs(c0.y - windowP0[i].y),
+                                       std::abs(c1.x - windowP1[i].x), std::abs(c1.y - windowP1[i].y)});
+    }
+
+    printSegmentThroughput("transform + Liang Barsky", segmentCount, liangTime);
+    printSegmentThroughput("Cyrus Beck", segmentCount, cyrusTime);
+    std::printf("  speedup: %.2fx, visible: %zu, visibility mismatches: %zu, max difference: %g\n",
+                liangTime / cyrusTime, visibleCount, mismatches, maxError);
+    std::printf("  against the scalar Cyrus Beck, visibility mismatches: %zu, max difference: %g\n\n", scalarMismatches, maxScalarError);
+
+    // Both only have to agree up to rounding, which the parameter along segments about 200 units long scales up
+    return reportCheck(scalarMismatches == 0 && maxScalarError <= 0.01f && maxError <= 0.05f, "Cyrus Beck differs from the scalar one, or from Liang Barsky");
+}
+
+// Area of a polygon, whatever its orientation
+static float getArea(std::span<const Vec2f> vertices)
+{
+    return vertices.size() < 3 ? 0.f : std::abs(detail::signedArea(vertices));
+}
+
+/*
+    Vertices that aren't in line with their neighbours, nor repeated. Sutherland Hodgman leaves spikes with no area
+    along the clip region, which depend on the order it clips against the edges, so only the actual corners of its
+    output are compared
+*/
+static size_t countCorners(std::span<const Vec2f> vertices)
+{
+    auto isNear = [](Vec2f p, Vec2f q) { return std::abs(p.x - q.x) < 1e-4f && std::abs(p.y - q.y) < 1e-4f; };
+
+    std::vector<Vec2f> distinct;
+
+    for(auto v : vertices)
+    {
+        if(distinct.empty() || !isNear(v, distinct.back()))
+            distinct.push_back(v);
+    }
+
+    while(distinct.size() > 1 && isNear(distinct.back(), distinct.front()))
+        distinct.pop_back();
+
+    size_t cornerCount{};
+
+    for(size_t i = 0; i < distinct.size(); ++i)
+    {
+        Vec2f d0 = distinct[i] - distinct[(i + distinct.size() - 1) % distinct.size()];
+        Vec2f d1 = distinct[(i + 1) % distinct.size()] - distinct[i];
+
+        float cross = d0.x * d1.y - d0.y * d1.x;
+
+        if(std::abs(cross) > 1e-4f * std::sqrt((d0.x * d0.x + d0.y * d0.y) * (d1.x * d1.x + d1.y * d1.y)))
+            ++cornerCount;
+    }
+
+    return cornerCount;
+}
+
+/*
+    Weiler Atherton checked against Sutherland Hodgman on random polygons around the window, star shaped so that they
+    are simple, most of them concave. Where a concave polygon is split, Sutherland Hodgman joins the parts with bridges
+    along the window, which have no area, so the sub polygons of Weiler Atherton must add up to its area. The convex
+    ones must also come out as a single polygon, with the same vertices. The same polygons are clipped against a
+    rotated window too, where it is in the world, with the convex region overloads of both algorithms, which must
+    agree with the window overloads run in window coordinates. Then a comb of 100k vertices is timed, each of its
+    teeth crossing the window, and coming out as its own sub polygon
+*/
+static bool benchmarkWeilerAtherton()
+{
+    constexpr size_t polygonCount = 20'000;
+    constexpr size_t toothCount = 25'000; // 4 vertices each
+
+    std::printf("Weiler Atherton, %zu random polygons, then a comb of %zu vertices\n", polygonCount, toothCount * 4);
+
+    Window win;
+    win.wmin = {-5.f, -5.f};
+    win.wmax = {5.f, 5.f};
+
+    std::mt19937 rng{7};
+    std::uniform_real_distribution<float> unit{0.f, 1.f};
+
+    // The convex region overloads clip where the window is in the world, they must match the window ones run on window
+    // coordinates, which is what the polygons of the world are clipped with
+    Window rotatedWin = win;
+    rotatedWin.rotate(30.f);
+
+    ConvexRegion rotatedRegion{rotatedWin.getWorldCorners()};
+
+    std::vector<Vec2f> polygon, clipped, scratch, windowPolygon, windowClipped;
+    size_t crossingCount{}, convexCount{}, areaMismatches{}, convexMismatches{};
+    size_t rotatedCount{}, regionMismatches{};
+
+    auto isSameVertexSet = [](std::span<const Vec2f> a, std::span<const Vec2f> b)
+    {
+        auto isNear = [](Vec2f p, Vec2f q) { return std::abs(p.x - q.x) < 1e-3f && std::abs(p.y - q.y) < 1e-3f; };
+
+        return std::ranges::all_of(a, [&](Vec2f p) { return std::ranges::any_of(b, [&](Vec2f q) { return isNear(p, q); }); })
+            && std::ranges::all_of(b, [&](Vec2f q) { return std::ranges::any_of(a, [&](Vec2f p) { return isNear(p, q); }); });
+    };
+
+    for(size_t i = 0; i < polygonCount; ++i)
+    {
+        // One vertex within each sector around the center, so that no two of them are more than 180 degrees apart
+        size_t n = 3 + rng() % 12;
+        Vec2f center{unit(rng) * 20.f - 10.f, unit(rng) * 20.f - 10.f};
+
+        polygon.clear();
+
+        for(size_t j = 0; j < n; ++j)
+            polygon.push_back(center + Affine2D::rotation((j + 0.9f * unit(rng)) * 360.f / n).apply({1.f + unit(rng) * 9.f, 0.f}));
+
+        if(i % 2) // Clockwise too
+            std::ranges::reverse(polygon);
+
+        auto shape = classifyPolygon(polygon);
+
+        if(rotatedWin.classify(shape.bounds) == Overlap::Partial)
+        {
+            ++rotatedCount;
+
+            windowPolygon.resize(polygon.size());
+            transformVertices(polygon, windowPolygon, rotatedWin.view);
+
+            sutherlandHodgman(polygon, rotatedRegion, clipped, scratch);
+            sutherlandHodgman(windowPolygon, rotatedWin, windowClipped, scratch);
+
+            auto regionSubPolygons = weilerAtherton(polygon, rotatedRegion);
+            auto windowSubPolygons = weilerAtherton(windowPolygon, rotatedWin);
+
+            auto isSameArea = [](float a, float b) { return std::abs(a - b) <= 1e-3f * std::max(b, 1.f); };
+
+            // Slivers left by a polygon only grazing a corner may go either way
+            auto sumUp = [](const auto& subPolygons, float& area, size_t& subPolygonCount, size_t& vertexCount)
+            {
+                for(const auto& subPoly : subPolygons)
+                {
+                    float subArea = getArea(subPoly);
+
+                    if(subArea < 1e-4f)
+                        continue;
+
+                    area += subArea;
+                    ++subPolygonCount;
+                    vertexCount += subPoly.size();
+                }
+            };
+
+            float regionArea{}, windowArea{};
+            size_t regionSubPolygonCount{}, windowSubPolygonCount{}, regionVertexCount{}, windowVertexCount{};
+
+            sumUp(regionSubPolygons, regionArea, regionSubPolygonCount, regionVertexCount);
+            sumUp(windowSubPolygons, windowArea, windowSubPolygonCount, windowVertexCount);
+
+            bool isSame = countCorners(clipped) == countCorners(windowClipped) && isSameArea(getArea(clipped), getArea(windowClipped))
+                       && regionSubPolygonCount == windowSubPolygonCount && regionVertexCount == windowVertexCount
+                       && isSameArea(regionArea, windowArea);
+
+            if(!isSame)
+                ++regionMismatches;
+        }
+
+        if(win.classify(shape.bounds) != Overlap::Partial)
+            continue;
+
+        ++crossingCount;
+
+        sutherlandHodgman(polygon, win, clipped, scratch);
+        auto subPolygons = weilerAtherton(polygon, win);
+
+        float area{};
+
+        for(const auto& subPoly : subPolygons)
+            area += getArea(subPoly);
+
+        float expectedArea = getArea(clipped);
+
+        if(std::abs(area - expectedArea) > 1e-3f * std::max(expectedArea, 1.f))
+            ++areaMismatches;
+
+        if(shape.isConvex)
+        {
+            ++convexCount;
+
+            bool isSame = expectedArea == 0.f ? subPolygons.empty() : subPolygons.size() == 1 && isSameVertexSet(subPolygons[0], clipped);
+
+            if(!isSame)
+                ++convexMismatches;
+        }
+    }
+
+    // The comb, its back below the window and its teeth going up across the whole window, from right to left
+    win.wmin = {-500.f, -500.f};
+    win.wmax = {500.f, 500.f};
+
+    float left = -490.f, right = 490.f;
+    float period = (right - left) / toothCount;
+
+    polygon = {{left, -600.f}, {right, -600.f}};
+
+    for(size_t k = toothCount; k-- > 0;)
+    {
+        float toothLeft = left + k * period;
+        float toothRight = k == toothCount - 1 ? right : toothLeft + period / 2;
+
+        polygon.insert(polygon.end(), {{toothRight, 600.f}, {toothLeft, 600.f}});
+
+        if(k > 0)
+            polygon.insert(polygon.end(), {{toothLeft, -550.f}, {toothLeft - period / 2, -550.f}});
+    }
+
+    std::vector<std::vector<Vec2f>> subPolygons;
+
+    double weilerTime = bestTimeOf([&] { subPolygons = weilerAtherton(polygon, win); });
+    double sutherlandTime = bestTimeOf([&] { sutherlandHodgman(polygon, win, clipped, scratch); });
+
+    // Summed in double. Sutherland Hodgman's area is a single sum over 100k vertices, so it's only compared up to rounding
+    double combArea{};
+
+    for(const auto& subPoly : subPolygons)
+        combArea += getArea(subPoly);
+
+    bool isCombRight = subPolygons.size() == toothCount && std::abs(combArea - getArea(clipped)) <= 1e-3 * combArea;
+
+    std::printf("  random polygons crossing the window: %zu, convex: %zu, area mismatches: %zu, convex mismatches: %zu\n",
+                crossingCount, convexCount, areaMismatches, convexMismatches);
+    std::printf("  crossing a rotated window: %zu, mismatches between the window and the convex region overloads: %zu\n",
+                rotatedCount, regionMismatches);
+    std::printf("  %-28s %10.2f ms\n", "Weiler Atherton", weilerTime * 1e3);
+    std::printf("  %-28s %10.2f ms\n", "Sutherland Hodgman", sutherlandTime * 1e3);
+    std::printf("  sub polygons: %zu, expected: %zu, area: %g, Sutherland Hodgman: %g\n\n", subPolygons.size(), toothCount,
+                combArea, getArea(clipped));
+
+    return reportCheck(areaMismatches == 0 && convexMismatches == 0, "Weiler Atherton differs from Sutherland Hodgman")
+         & reportCheck(regionMismatches == 0, "clipping against a convex region differs from clipping in window coordinates")
+         & reportCheck(isCombRight, "Weiler Atherton didn't split the comb into its teeth");
+}
+
+// A frame in which the window moved, zoomed into a small part of the scene (0.1% of it), with and without the spatial index
+static bool benchmarkWindowCulling()
+{
+    constexpr size_t objectCount = 2'000'000;
+
+    std::printf("Moving a window zoomed into the scene, %zu objects\n", objectCount);
+
+    // Short segments, unlike the ones of randomWorld, which cross most of the scene
+    auto vertices = randomVertices(objectCount);
+    auto offsets = randomVertices(objectCount);
+    std::vector<Vec2f> polyVertices(6);
+
+    World world;
+
+    for(size_t i = 0; i < objectCount; ++i)
+    {
+        if(i % 4 < 2)
+            world.add(Point{vertices[i]});
+        else
+        if(i % 4 == 2)
+            world.add(LineSegment{vertices[i], vertices[i] + offsets[i] * 0.01f});
+        else
+        {
+            for(size_t j = 0; j < polyVertices.size(); ++j)
+                polyVertices[j] = vertices[i] + Affine2D::rotation(60.f * j).apply({0.5f, 0.f});
+
+            world.add(polyVertices);
+        }
+    }
+
+    Window win;
+    win.wmin = {-3.f, -3.f};
+    win.wmax = {3.f, 3.f};
+
+    Viewport vp;
+    vp.borderW = vp.borderH = 10.f;
+    vp.setSize(600.f, 600.f);
+
+    auto worldToViewport = win.worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height});
+
+    double allTime = bestTimeOf([&]
+    {
+        world.points.toViewportCoord(worldToViewport);
+        world.lines.toViewportCoord(worldToViewport);
+        world.polygons.toViewportCoord(worldToViewport);
+    });
+
+    world.updateVisibleObjects(win.getWorldBounds()); // Builds the index
+
+    double indexedTime = bestTimeOf([&]
+    {
+        win.translate({0.01f, 0.f});
+        world.updateVisibleObjects(win.getWorldBounds());
+        world.updateViewportCoord(win, vp);
+    });
+
+    // Every object overlapping the window has to be found
+    auto region = win.getWorldBounds();
+    size_t expected{};
+
+    for(size_t i = 0; i < world.size(); ++i)
+        expected += classifyBounds(world.getBounds(world.getRef(i)), region) != Overlap::Outside;
+
+    std::printf("  %-28s %10.2f ms\n", "mapping every object", allTime * 1e3);
+    std::printf("  %-28s %10.2f ms\n", "spatial index", indexedTime * 1e3);
+    std::printf("  speedup: %.2fx, visible objects: %zu, expected: %zu\n\n", allTime / indexedTime,
+                world.getVisibleObjects().size(), expected);
+
+    return reportCheck(world.getVisibleObjects().size() == expected, "the spatial index missed objects within the window");
+}
+
+/*
+    Digest of the recording of benchmarkHeadlessDrawing, taken from a known good build (GCC on x86-64). The batched
+    kernels round differently with FMA, so each SIMD path has its own. It has to be taken again, from the digest
+    printed by the benchmark, whenever a change is meant to alter what is drawn
+*/
+#if defined(MIRRAS_AVX2)
+static constexpr uint64_t goldenDrawingDigest = 0xeec4ad2d1745a77d;
+#elif defined(MIRRAS_SSE2)
+static constexpr uint64_t goldenDrawingDigest = 0x011f7e014d12be1d;
+#else
+static constexpr uint64_t goldenDrawingDigest = 0; // None was taken, only checked against the serial recording
+#endif
+
+/*
+    The whole path the Viewport window goes through every frame, with the primitives recorded instead of handed to
+    ImGui, with the global window and viewport, as in the application. The recording must match the digest of a known
+    good one, and the recording of a world clipped on a single thread must come out the same, down to the last bit
+*/
+static bool benchmarkHeadlessDrawing()
+{
+    constexpr size_t objectCount = 1'000'000;
+
+    std::printf("Drawing the visible objects into a recorder, %zu objects\n", objectCount);
+
+    World world = randomWorld(objectCount);
+    World serialWorld = randomWorld(objectCount);
+
+    g_Window.wmin = {-20.f, -20.f};
+    g_Window.wmax = {20.f, 20.f};
+    g_Window.rotate(30.f);
+
+    g_Viewport.borderW = g_Viewport.borderH = 10.f;
+    g_Viewport.setSize(800.f, 800.f);
+
+    DrawRecorder recorder, serialRecorder;
+    WorkerPool serialPool{0};
+
+    DrawTarget drawTarget{.backend = &recorder,
+                          .window = &g_Window,
+                          .viewport = &g_Viewport,
+                          .thickness = 1.5f,
+                          .clipping = {.enableLiangBarsky = true, .enableWeilerAtherton = true}};
+
+    findVisibleObjects(world, g_Window, g_Viewport, drawTarget);
+    objectsToViewportCoord(world, g_Window, g_Viewport);
+    clipObjects(world, g_Window, g_Viewport, drawTarget.clipping, nullptr);
+
+    double drawTime = bestTimeOf([&]
+    {
+        recorder.clear();
+        drawObjects(world, drawTarget);
+    });
+
+    auto serialTarget = drawTarget;
+    serialTarget.backend = &serialRecorder;
+
+    findVisibleObjects(serialWorld, g_Window, g_Viewport, serialTarget);
+    objectsToViewportCoord(serialWorld, g_Window, g_Viewport);
+    serialWorld.updateClippedGeometry(g_Window, g_Viewport, serialTarget.clipping, nullptr, serialPool);
+    drawObjects(serialWorld, serialTarget);
+
+    uint64_t digest = recorder.getDigest();
+    bool isSameAsSerial = recorder.isSameAs(serialRecorder);
+    bool isGolden = goldenDrawingDigest == 0 || digest == goldenDrawingDigest;
+
+    std::printf("  %-28s %10.2f ms\n", "drawObjects", drawTime * 1e3);
+    std::printf("  visible: %zu, primitives: %zu, vertices: %zu, same as the serial result: %s\n",
+                world.getVisibleObjects().size(), recorder.primitives.size(), recorder.vertices.size(), isSameAsSerial ? "yes" : "NO");
+    std::printf("  digest: %016llx, known good: %016llx%s\n\n", (unsigned long long) digest, (unsigned long long) goldenDrawingDigest,
+                goldenDrawingDigest == 0 ? " (none for this build)" : "");
+
+    return reportCheck(isSameAsSerial, "the recording differs from the serial one")
+         & reportCheck(isGolden, "the recording doesn't match the known good digest");
+}
+
+// The viewport rendered at a few times its size, as when exporting it for a report
+static bool benchmarkRasterizer()
+{
+    constexpr size_t objectCount = 400'000;
+    constexpr float scale = 4.f;
+
+    // Short segments, unlike the ones of randomWorld, which would cover most of the image at this scale
+    auto vertices = randomVertices(objectCount);
+    auto offsets = randomVertices(objectCount);
+    std::vector<Vec2f> polyVertices(6);
+
+    World world;
+
+    for(size_t i = 0; i < objectCount; ++i)
+    {
+        if(i % 4 < 2)
+            world.add(Point{vertices[i]});
+        else
+        if(i % 4 == 2)
+            world.add(LineSegment{vertices[i], vertices[i] + offsets[i] * 0.02f});
+        else
+        {
+            for(size_t j = 0; j < polyVertices.size(); ++j)
+                polyVertices[j] = vertices[i] + Affine2D::rotation(60.f * j).apply({0.5f, 0.f});
+
+            world.add(polyVertices);
+        }
+    }
+
+    g_Window.wmin = {-50.f, -50.f};
+    g_Window.wmax = {50.f, 50.f};
+
+    g_Viewport.borderW = g_Viewport.borderH = 10.f;
+    g_Viewport.setSize(800.f, 800.f);
+
+    DrawRecorder recorder;
+
+    DrawTarget drawTarget{.backend = &recorder,
+                          .window = &g_Window,
+                          .viewport = &g_Viewport,
+                          .thickness = 1.5f,
+                          .clipping = {.enableLiangBarsky = true, .enableWeilerAtherton = true}};
+
+    findVisibleObjects(world, g_Window, g_Viewport, drawTarget);
+    objectsToViewportCoord(world, g_Window, g_Viewport);
+    clipObjects(world, g_Window, g_Viewport, drawTarget.clipping, nullptr);
+    drawObjects(world, drawTarget);
+
+    RasterOptions options{.width = uint32_t((g_Viewport.width + 2 * g_Viewport.borderW) * scale),
+                          .height = uint32_t((g_Viewport.height + 2 * g_Viewport.borderH) * scale),
+                          .scale = scale};
+
+    std::printf("Rasterizing the viewport at %ux%u, %zu primitives, threads: %zu\n", options.width, options.height,
+                recorder.primitives.size(), g_WorkerPool.threadCount());
+
+    WorkerPool serialPool{0};
+    Image serialImage, parallelImage;
+
+    double serialTime = bestTimeOf([&] { serialImage = rasterize(recorder, options, serialPool); });
+    double parallelTime = bestTimeOf([&] { parallelImage = rasterize(recorder, options, g_WorkerPool); });
+
+    std::printf("  %-28s %10.2f ms\n", "serial", serialTime * 1e3);
+    std::printf("  %-28s %10.2f ms\n", "worker pool", parallelTime * 1e3);
+    std::printf("  speedup: %.2fx, identical to the serial result: %s\n\n", serialTime / parallelTime,
+                serialImage.pixels == parallelImage.pixels ? "yes" : "NO");
+
+    return reportCheck(serialImage.pixels == parallelImage.pixels, "the image rasterized on the pool differs from the serial one");
+}
+
+int runBenchmarks()
+{
+    // Every benchmark runs, even after one of them failed, so that all the failures show up at once
+    bool hasPassed = true;
+
+    hasPassed &= benchmarkViewportMapping();
+    hasPassed &= benchmarkAffineTransform();
+    hasPassed &= benchmarkParallelTransform();
+    hasPassed &= benchmarkParallelClipping();
+    hasPassed &= benchmarkLiangBarsky();
+    hasPassed &= benchmarkCohenSutherland();
+    hasPassed &= benchmarkCyrusBeck();
+    hasPassed &= benchmarkWeilerAtherton();
+    hasPassed &= benchmarkWindowCulling();
+    hasPassed &= benchmarkHeadlessDrawing();
+    hasPassed &= benchmarkRasterizer();
+
+    std::printf(hasPassed ? "All the self-checks passed\n" : "Some self-checks FAILED\n");
+
+    return hasPassed ? 0 : 1;
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace mirras
+{
+// Runs the micro benchmarks of the object pipeline and prints the results to the standard output.
+// It doesn't need a window nor an OpenGL context, so it can run on machines without a display.
+// Each benchmark also checks its results, the exit code is nonzero when any of those checks fails
+int runBenchmarks();
+
+} // namespace mirras
\ No newline at end of file
@@ -1,7 +1,18 @@
+#pragma once
+
 #include <vector>
+#include <span>
+#include <optional>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cfloat>
+#include <array>
+#include <numeric>
 
 #include "vec2f.h"
-#include "objects.h"
+#include "representation.h"
 
 namespace mirras
 {
@@ -11,475 +22,612 @@ struct LineSeg
     Vec2f p0, p1;
 };
 
-struct Vertex
+/*
+    Any convex polygon to clip against, such as the window as seen from the world, which is rotated along with it.
+    Kept counterclockwise, with the inward unit normal of each edge, so that the signed distance from a point to
+    the line of an edge is a single dot product, positive inside
+*/
+struct ConvexRegion
+{
+    ConvexRegion() = default;
+
+    explicit ConvexRegion(std::span<const Vec2f> polyVertices)
+    {
+        // Repeated vertices would give edges without a direction
+        for(auto v : polyVertices)
+        {
+            if(vertices.empty() || (v != vertices.back() && v != vertices.front()))
+                vertices.push_back(v);
+        }
+
+        float area{};
+
+        for(size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+            area += vertices[j].x * vertices[i].y - vertices[i].x * vertices[j].y;
+
+        if(area < 0.f)
+            std::reverse(vertices.begin(), vertices.end());
+
+        for(size_t i = 0; i < vertices.size(); ++i)
+        {
+            Vec2f edge = vertices[(i + 1) % vertices.size()] - vertices[i];
+            float length = std::sqrt(edge.x * edge.x + edge.y * edge.y);
+
+            // The interior is on the left of each edge
+            Vec2f normal = Vec2f{-edge.y, edge.x} / length;
+
+            normals.push_back(normal);
+            offsets.push_back(normal.x * vertices[i].x + normal.y * vertices[i].y);
+            perimeterPos.push_back(perimeter);
+
+            perimeter += length;
+        }
+    }
+
+    float distance(size_t edge, Vec2f p) const
+    {
+        return normals[edge].x * p.x + normals[edge].y * p.y - offsets[edge];
+    }
+
+    bool isInside(Vec2f p) const
+    {
+        for(size_t i = 0; i < normals.size(); ++i)
+        {
+            if(distance(i, p) < 0.f)
+                return false;
+        }
+
+        return true;
+    }
+
+    size_t size() const { return vertices.size(); }
+
+    std::vector<Vec2f> vertices;
+    std::vector<Vec2f> normals;
+    std::vector<float> offsets;      // Of the line of each edge, along its normal
+    std::vector<float> perimeterPos; // Of each vertex, counterclockwise from the first one
+    float perimeter{};
+};
+
+/*
+    Weiler Atherton against the window, in window coordinates, or against any convex region, for polygons of any
+    shape (holes aside). The region is only reached through a boundary type, see WindowBoundary and ConvexBoundary.
+
+    Instead of inserting the intersections into linked lists of vertices as they are found, each polygon edge
+    is clipped to the window once (its part inside the window is a single interval of its parameter t, as the window
+    is convex), which yields at most one entering and one exiting intersection per edge, already in the order of
+    the polygon. Each intersection also gets its position along the perimeter of the window, which is the only
+    thing that needs sorting. Both orders are then kept as arrays of indices, so walking either boundary from one
+    intersection to the next is O(1), and the whole clipping is O((n + k) log k), for n vertices and k intersections.
+    Points on the border of the window count as inside, so touching it from outside yields nothing
+*/
+namespace detail
+{
+struct WAIntersection
 {
     Vec2f pos;
-    int id{-1};
-    bool isIntersection{};
+    uint32_t edge{};  // Index of the polygon edge it's on, which starts at vertices[edge]
+    float t{};        // ... and its position along it
+    float perimeterPos{};
     bool isEntering{};
 };
 
-enum Orientation : uint8_t
+// Part of the segment inside the window, as [t0, t1], empty when t0 > t1
+inline std::pair<float, float> insideInterval(Vec2f p0, Vec2f p1, const Window& win)
 {
-    Clockwise,
-    CounterClockwise,
-    Collinear
-};
+    float dx = p1.x - p0.x;
+    float dy = p1.y - p0.y;
+
+    float p[4] = {-dx, dx, -dy, dy};
+    float q[4] = {p0.x - win.wmin.x, win.wmax.x - p0.x, p0.y - win.wmin.y, win.wmax.y - p0.y};
+
+    float t0{}, t1{1.f};
+
+    for(int i = 0; i < 4; ++i)
+    {
+        if(p[i] > 0.f)
+            t1 = std::min(t1, q[i] / p[i]);
+        else
+        if(p[i] < 0.f)
+            t0 = std::max(t0, q[i] / p[i]);
+        else
+        if(q[i] < 0.f)
+            return {1.f, 0.f};
+    }
 
-inline Orientation getOrientation(Vec2f p0, Vec2f p1, Vec2f p2)
+    return {t0, t1};
+}
+
+// Snaps a point to the closest window edge, and gives its position along the perimeter, counterclockwise from wmin
+inline float snapToPerimeter(Vec2f& p, const Window& win)
 {
-    float determinant = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+    float width = win.wmax.x - win.wmin.x;
+    float height = win.wmax.y - win.wmin.y;
+
+    p.x = std::clamp(p.x, win.wmin.x, win.wmax.x);
+    p.y = std::clamp(p.y, win.wmin.y, win.wmax.y);
+
+    float distances[4] = {p.y - win.wmin.y, win.wmax.x - p.x, win.wmax.y - p.y, p.x - win.wmin.x}; // Bottom, right, top, left
+    int edge = int(std::min_element(distances, distances + 4) - distances);
 
-    if(determinant < 0.f) return Clockwise; // p2 is on the right side of vector p0->p1
-    if(determinant > 0.f) return CounterClockwise; // p2 is on the left side of vector p0->p1
-    return Collinear; // All 3 points are collinear
+    switch(edge)
+    {
+    case 0:  p.y = win.wmin.y; return p.x - win.wmin.x;
+    case 1:  p.x = win.wmax.x; return width + (p.y - win.wmin.y);
+    case 2:  p.y = win.wmax.y; return width + height + (win.wmax.x - p.x);
+    default: p.x = win.wmin.x; return 2.f * width + height + (win.wmax.y - p.y);
+    }
 }
 
-// Given a segment and a point that are colinear, check if p lies on the segment
-inline bool liesOnSegment(LineSeg l, Vec2f p)
+inline bool isInsideWindow(Vec2f p, const Window& win)
 {
-    if (p.x <= std::max(l.p0.x, l.p1.x) && p.x >= std::min(l.p0.x, l.p1.x) &&
-        p.y <= std::max(l.p0.y, l.p1.y) && p.y >= std::min(l.p0.y, l.p1.y))
-        return true;
-  
-    return false;
+    return p.x >= win.wmin.x && p.x <= win.wmax.x && p.y >= win.wmin.y && p.y <= win.wmax.y;
 }
 
-inline bool checkIntersection(LineSeg l0, LineSeg l1)
+// Even odd rule
+inline bool isInsidePolygon(Vec2f p, std::span<const Vec2f> vertices)
 {
-    auto o1 = getOrientation(l0.p0, l0.p1, l1.p0);
-    auto o2 = getOrientation(l0.p0, l0.p1, l1.p1);
-    auto o3 = getOrientation(l1.p0, l1.p1, l0.p0);
-    auto o4 = getOrientation(l1.p0, l1.p1, l0.p1);
+    bool isInside{};
 
-    if (o1 != o2 && o3 != o4)
-        return true;
+    for(size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+    {
+        Vec2f a = vertices[i], b = vertices[j];
 
-    if(o1 == Collinear && liesOnSegment(l0, l1.p0)) return true;
+        if((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+            isInside = !isInside;
+    }
 
-    if(o2 == Collinear && liesOnSegment(l0, l1.p1)) return true;
+    return isInside;
+}
 
-    if(o3 == Collinear && liesOnSegment(l1, l0.p0)) return true;
+inline float signedArea(std::span<const Vec2f> vertices)
+{
+    float area{};
 
-    if(o4 == Collinear && liesOnSegment(l1, l0.p1)) return true;
+    for(size_t i = 0, j = vertices.size() - 1; i < vertices.size(); j = i++)
+        area += vertices[j].x * vertices[i].y - vertices[i].x * vertices[j].y;
 
-    return false;
+    return area / 2.f;
 }
 
-inline std::optional<Vec2f> getIntersectionPos(LineSeg l0, LineSeg l1)
+// Part of the segment inside the region, as [t0, t1], empty when t0 > t1. Cyrus Beck
+inline std::pair<float, float> insideInterval(Vec2f p0, Vec2f p1, const ConvexRegion& region)
 {
-    if(!checkIntersection(l0, l1))
-        return{};
-    
-    float a1 = l0.p1.y - l0.p0.y;
-    float b1 = l0.p0.x - l0.p1.x;
-    float c1 = a1 * (l0.p0.x) + b1 * (l0.p0.y);
- 
-    float a2 = l1.p1.y - l1.p0.y;
-    float b2 = l1.p0.x - l1.p1.x;
-    float c2 = a2 * (l1.p0.x) + b2 * (l1.p0.y);
- 
-    float determinant = a1 * b2 - a2 * b1;
- 
-    if (determinant == 0)
-        return {};
+    Vec2f d = p1 - p0;
 
-    float x = (b2 * c1 - b1 * c2) / determinant;
-    float y = (a1 * c2 - a2 * c1) / determinant;
-    
-    return Vec2f{x, y};
-}
+    float t0{}, t1{1.f};
 
-// Init and return the clipped polygon list, without intersections
-inline std::vector<Vertex> getClippedPolyList(const Polygon& poly)
-{
-    std::vector<Vertex> clippedPoly;
-    clippedPoly.reserve(poly.vertices.size() + 4);
+    for(size_t i = 0; i < region.size(); ++i)
+    {
+        float dist = region.distance(i, p0);
+        float speed = region.normals[i].x * d.x + region.normals[i].y * d.y; // Towards the inside
 
-    // Use the viewport coordinates in this case, because we are clipping against the Viewport
-    for(const auto& v :  poly.vertices)
-        clippedPoly.emplace_back(Vertex{v});
+        if(speed > 0.f)
+            t0 = std::max(t0, -dist / speed);
+        else
+        if(speed < 0.f)
+            t1 = std::min(t1, -dist / speed);
+        else
+        if(dist < 0.f)
+            return {1.f, 0.f};
+    }
 
-    return clippedPoly;
+    return {t0, t1};
 }
 
-// Init and return the clipping polygon list, without intersections
-inline std::vector<Vertex> getClippingPolyList(const std::vector<Vec2f>& winPoints)
+/*
+    What Weiler Atherton needs to know about the region it clips against: which points are inside, where segments
+    cross its border, the position of a point along its perimeter, and its corners. One for the window, in window
+    coordinates, and one for any convex region
+*/
+struct WindowBoundary
 {
-    std::vector<Vertex> clippingPoly;
-    clippingPoly.reserve(winPoints.size() + 4);
-    
-    for(const auto& p : winPoints)
-        clippingPoly.emplace_back(Vertex{p});
+    const Window& win;
 
-    return clippingPoly;
-}
+    bool isInside(Vec2f p) const { return isInsideWindow(p, win); }
+
+    std::pair<float, float> insideInterval(Vec2f p0, Vec2f p1) const { return detail::insideInterval(p0, p1, win); }
+
+    float snapToPerimeter(Vec2f& p) const { return detail::snapToPerimeter(p, win); }
+
+    float getPerimeter() const { return 2.f * (win.wmax.x - win.wmin.x) + 2.f * (win.wmax.y - win.wmin.y); }
+
+    bool isAlongBorder(Vec2f a, Vec2f b) const
+    {
+        return (a.x == b.x && (a.x == win.wmin.x || a.x == win.wmax.x)) || (a.y == b.y && (a.y == win.wmin.y || a.y == win.wmax.y));
+    }
+
+    Vec2f getCenter() const { return (win.wmin + win.wmax) / 2.f; }
+
+    // Along with their position on the perimeter
+    std::vector<std::pair<float, Vec2f>> getCorners() const
+    {
+        return {{0.f, win.wmin},
+                {win.wmax.x - win.wmin.x, {win.wmax.x, win.wmin.y}},
+                {getPerimeter() / 2.f, win.wmax},
+                {getPerimeter() - (win.wmax.y - win.wmin.y), {win.wmin.x, win.wmax.y}}};
+    }
+};
 
-// Sort the intersections between each clipping poly segment with respect to the segment's starting point
-inline void sortIntersectionsForEachSegmentOf(std::vector<Vertex>& clippingPoly)
+struct ConvexBoundary
 {
-    auto begin = clippingPoly.begin();
-    
-    for(size_t i = 0; i < clippingPoly.size() - 1; ++i)
+    const ConvexRegion& region;
+
+    bool isInside(Vec2f p) const { return region.isInside(p); }
+
+    std::pair<float, float> insideInterval(Vec2f p0, Vec2f p1) const { return detail::insideInterval(p0, p1, region); }
+
+    // Onto the closest point of the border
+    float snapToPerimeter(Vec2f& p) const
     {
-        if(clippingPoly[i].isIntersection)
-            continue;
-        
-        for(size_t j = i + 1; j < clippingPoly.size() + 1; ++j)
+        float minDistSq = FLT_MAX;
+        float pos{};
+        Vec2f closest = p;
+
+        for(size_t i = 0; i < region.size(); ++i)
         {
-            size_t idx = j % clippingPoly.size();
+            Vec2f a = region.vertices[i];
+            Vec2f edge = region.vertices[(i + 1) % region.size()] - a;
+            float length = std::sqrt(edge.x * edge.x + edge.y * edge.y);
 
-            if(clippingPoly[idx].isIntersection)
-                continue;
+            float along = std::clamp(((p.x - a.x) * edge.x + (p.y - a.y) * edge.y) / length, 0.f, length);
+            Vec2f onEdge = a + edge * (along / length);
+
+            float distSq = (p.x - onEdge.x) * (p.x - onEdge.x) + (p.y - onEdge.y) * (p.y - onEdge.y);
 
-            std::sort((begin + i + 1), (begin + j), [&clippingPoly, i](const Vertex& v1, const Vertex& v2)
+            if(distSq < minDistSq)
             {
-                float dist1 = std::pow(v1.pos.x - clippingPoly[i].pos.x, 2) + std::pow(v1.pos.y - clippingPoly[i].pos.y, 2);
-                float dist2 = std::pow(v2.pos.x - clippingPoly[i].pos.x, 2) + std::pow(v2.pos.y - clippingPoly[i].pos.y, 2);
-
-                return dist1 < dist2;
-            });
-            
-            i = j - 1;
-            break;
+                minDistSq = distSq;
+                closest = onEdge;
+                pos = region.perimeterPos[i] + along;
+            }
         }
+
+        p = closest;
+        return pos;
     }
-}
 
+    float getPerimeter() const { return region.perimeter; }
+
+    // The edges are seldom axis aligned, so points snapped onto them are only on them up to rounding
+    bool isAlongBorder(Vec2f a, Vec2f b) const
+    {
+        float tolerance = region.perimeter * 1e-6f;
+
+        for(size_t i = 0; i < region.size(); ++i)
+        {
+            if(std::abs(region.distance(i, a)) <= tolerance && std::abs(region.distance(i, b)) <= tolerance)
+                return true;
+        }
+
+        return false;
+    }
+
+    Vec2f getCenter() const
+    {
+        Vec2f sum{};
+
+        for(auto v : region.vertices)
+            sum = sum + v;
+
+        return sum / (float) region.size();
+    }
+
+    std::vector<std::pair<float, Vec2f>> getCorners() const
+    {
+        std::vector<std::pair<float, Vec2f>> corners;
+
+        for(size_t i = 0; i < region.size(); ++i)
+            corners.push_back({region.perimeterPos[i], region.vertices[i]});
+
+        return corners;
+    }
+};
 
-// In this step I tried to insert the intersections in the right place as I found them, in the hope of increasing
-// the performance, maybe not worth it, but not sure if it would make things simpler by inserting them later.
-// There are many edge cases, I couldn't account for them all.
-inline void placeIntersectionsInto(std::vector<Vertex>& clippedPoly, std::vector<Vertex>& clippingPoly, const Polygon& poly, const std::vector<Vec2f>& winPoints)
+template<typename Boundary>
+std::vector<std::vector<Vec2f>> weilerAtherton(std::span<const Vec2f> vertices, const Boundary& boundary)
 {
-    auto it = clippedPoly.begin();
-    uint32_t streakNoIntersect{0};
-    int vertexId{};
+    std::vector<std::vector<Vec2f>> subPolygons;
+
+    size_t n = vertices.size();
+
+    if(n < 3)
+        return subPolygons;
 
-    for(size_t i = 0; i < poly.vertices.size(); ++i)
+    // The window is walked in the same direction as the polygon, so the perimeter is flipped for clockwise ones
+    bool isClockwise = signedArea(vertices) < 0.f;
+    float perimeter = boundary.getPerimeter();
+
+    auto alongWindow = [&](float perimeterPos)
     {
-        bool didIntersect{};
-        uint32_t numInterSamePolySeg{};
-        bool vertAlreadyAdded{};
-        bool addInterOnNextIter{};
-        
-        for(size_t j = 0; j < winPoints.size(); ++j)
-        {
-            size_t polyNextVertexIdx = (i + 1) % poly.vertices.size();
-            size_t winNextPointIdx = (j + 1) % winPoints.size();
-            
-            auto intersectPos = getIntersectionPos(LineSeg{poly.vertices[i], poly.vertices[polyNextVertexIdx]},
-                                                   LineSeg{winPoints[j], winPoints[winNextPointIdx]});
-                                                   
-            if(!intersectPos)
-                continue;
+        return isClockwise ? std::fmod(perimeter - perimeterPos, perimeter) : perimeterPos;
+    };
 
-            bool isEntering{};
+    // Intersections, in the order of the polygon
+    std::vector<WAIntersection> intersections;
 
-            auto orient1 = getOrientation(winPoints[j], winPoints[winNextPointIdx], poly.vertices[i]);
-            auto orient2 = getOrientation(winPoints[j], winPoints[winNextPointIdx], poly.vertices[polyNextVertexIdx]);
-            
-            // Some edge cases
+    auto addIntersection = [&](uint32_t edge, float t, bool isEntering)
+    {
+        Vec2f p0 = vertices[edge], p1 = vertices[(edge + 1) % n];
+        Vec2f pos = p0 + (p1 - p0) * t;
 
-            if(orient1 == Collinear && orient2 == Collinear)
-                continue;
-                
-            if(orient1 == CounterClockwise && orient2 == Collinear)
-                isEntering = true;
-                
-            if(orient1 == Clockwise && orient2 == Collinear)
+        float perimeterPos = alongWindow(boundary.snapToPerimeter(pos));
+
+        intersections.push_back({pos, edge, t, perimeterPos, isEntering});
+    };
+
+    bool isCurrInside = boundary.isInside(vertices[0]);
+    bool isFirstInside = isCurrInside;
+
+    for(uint32_t i = 0; i < n; ++i)
+    {
+        bool isNextInside = (i + 1 == n) ? isFirstInside : boundary.isInside(vertices[i + 1]);
+
+        if(!isCurrInside || !isNextInside)
+        {
+            auto[t0, t1] = boundary.insideInterval(vertices[i], vertices[(i + 1) % n]);
+
+            if(isCurrInside) // Only leaves
+                addIntersection(i, std::max(t1, 0.f), false);
+            else
+            if(isNextInside) // Only enters
+                addIntersection(i, std::min(t0, 1.f), true);
+            else
+            if(t0 < t1) // Goes through, just touching a corner doesn't count
             {
-                size_t thirdVertexIdx = (i + 2) % poly.vertices.size();
-                
-                auto orient = getOrientation(winPoints[j], winPoints[winNextPointIdx], poly.vertices[thirdVertexIdx]);
-                
-                if(orient == Clockwise || orient == Collinear)
-                    continue;
-
-                if(orient == CounterClockwise)
-                    isEntering = false;
+                addIntersection(i, t0, true);
+                addIntersection(i, t1, false);
             }
-                
-            if(orient1 == Collinear && orient2 == Clockwise)
+        }
+
+        isCurrInside = isNextInside;
+    }
+
+    // Vertices of the polygon strictly between two intersections
+    auto verticesBetween = [&](const WAIntersection& from, const WAIntersection& to)
+    {
+        size_t count = (to.edge + n - from.edge) % n;
+
+        if(count == 0 && to.t < from.t)
+            count = n;
+
+        return count;
+    };
+
+    // An entering intersection followed by an exiting one, with only the border of the window between them, means the
+    // polygon just touches the window from outside. Both are dropped, the window border goes through there anyway
+    auto isAlongBorder = [&](Vec2f a, Vec2f b) { return boundary.isAlongBorder(a, b); };
+
+    if(intersections.size() >= 2)
+    {
+        std::vector<uint8_t> isTouching(intersections.size());
+
+        for(size_t i = 0; i < intersections.size(); ++i)
+        {
+            const auto& entering = intersections[i];
+            const auto& exiting = intersections[(i + 1) % intersections.size()];
+
+            if(!entering.isEntering || exiting.isEntering)
                 continue;
 
-            if(orient1 == Collinear && orient2 == CounterClockwise)
-                isEntering = false;
-            
-            if(orient1 == CounterClockwise && orient2 == Clockwise && (*intersectPos == winPoints[j] || *intersectPos == winPoints[winNextPointIdx]))
-            {
-                // Polygon segment is tangent to one corner of the window
-                if(*intersectPos == winPoints[0])
-                {
-                    auto orient = getOrientation(winPoints[winPoints.size() - 1], winPoints[0], poly.vertices[polyNextVertexIdx]);
-                    
-                    if(orient == CounterClockwise)
-                        continue;
-                }
-                else
-                {
-                    size_t thirdWinPointIdx = (j + 2) % winPoints.size();
-                    auto orient = getOrientation(winPoints[winNextPointIdx], winPoints[thirdWinPointIdx], poly.vertices[polyNextVertexIdx]);
-                    
-                    if(orient == CounterClockwise)
-                        continue;
-                }
-            }
+            Vec2f prev = entering.pos;
+            bool isTouchingOnly = true;
 
-            if(orient1 == Clockwise && orient2 == CounterClockwise && (*intersectPos == winPoints[j] || *intersectPos == winPoints[winNextPointIdx]))
-            {
-                // Polygon segment is tangent to one corner of the window
-                if(*intersectPos == winPoints[0])
-                {
-                    auto orient = getOrientation(winPoints[winPoints.size() - 1], winPoints[0], poly.vertices[i]);
-                    
-                    if(orient == CounterClockwise)
-                        continue;
-                }
-                else
-                {
-                    size_t thirdWinPointIdx = (j + 2) % winPoints.size();
-                    auto orient = getOrientation(winPoints[winNextPointIdx], winPoints[thirdWinPointIdx], poly.vertices[i]);
-                    
-                    if(orient == CounterClockwise)
-                        continue;
-                }
-            }
-                
-            ++numInterSamePolySeg;
-
-            if(orient2 == Clockwise)
-                isEntering = true;
-
-            auto itTemp = it + streakNoIntersect + 1;
-            
-            if(itTemp > clippedPoly.end())
-                itTemp = clippedPoly.end();
-
-            /*
-                Place the intersections within the clipped poly
-            */
-
-            bool addIntersection = addInterOnNextIter;
-            bool sameVertex{};
-            
-            // Treat the case when a single polygon segment intersects the window more than once
-            if(numInterSamePolySeg == 2)
+            for(size_t v = 1; v <= verticesBetween(entering, exiting) && isTouchingOnly; ++v)
             {
-                Vertex previous = *it;
-
-                float dist1 = std::pow(previous.pos.x - poly.vertices[i].x, 2) + std::pow(previous.pos.y - poly.vertices[i].y, 2);
-                float dist2 = std::pow(intersectPos->x - poly.vertices[i].x, 2) + std::pow(intersectPos->y - poly.vertices[i].y, 2);
-
-                if(dist1 > dist2)
-                {
-                    Vec2f prevPos = previous.pos;
-                    int id = previous.id;
-                    
-                    previous.pos.x = intersectPos->x;
-                    previous.pos.y = intersectPos->y;
-                    previous.isEntering = true;
-                    previous.id = vertexId;
-
-                    *it = previous;
-                    
-                    if(itTemp != clippedPoly.end())
-                        --itTemp;
-
-                    it = clippedPoly.emplace(itTemp, Vertex{prevPos, id, true, false});
-                }
-                else
-                if(dist1 < dist2)
-                {
-                    if(i != poly.vertices.size() - 1 || itTemp != clippedPoly.end())
-                        --itTemp;
-                    
-                    it = clippedPoly.emplace(itTemp, Vertex{*intersectPos, vertexId, true, isEntering});
-                }
-                else
-                {
-                    if(itTemp == clippedPoly.end() && i == poly.vertices.size() - 1 && j == winPoints.size() - 1)
-                    {                            
-                        auto it1 = clippedPoly.end() - 1;
-                        auto it2 = clippedPoly.end() - 2;
-
-                        std::swap(*it1, *it2);
-                    }
-                    
-                    numInterSamePolySeg = 0;
-                    addInterOnNextIter = true;
-                    sameVertex = true;
-                }
-
-                vertAlreadyAdded = true;
+                Vec2f curr = vertices[(entering.edge + v) % n];
+                isTouchingOnly = curr == prev || isAlongBorder(prev, curr);
+                prev = curr;
             }
-                
-            if(!vertAlreadyAdded || addIntersection)
-            {
-                it = clippedPoly.emplace(itTemp, Vertex{*intersectPos, vertexId, true, isEntering});
-                addInterOnNextIter = false;
-            }
-            
-            /*
-                Place the intersections within the clipping poly
-            */
 
-            uint32_t count{0};
-            bool addInterLater{};
+            if(isTouchingOnly && (exiting.pos == prev || isAlongBorder(prev, exiting.pos)))
+                isTouching[i] = isTouching[(i + 1) % intersections.size()] = true;
+        }
+
+        std::erase_if(intersections, [&](const WAIntersection& inter) { return isTouching[&inter - intersections.data()]; });
+    }
+
+    // Without intersections, either one contains the other or they don't overlap
+    if(intersections.empty())
+    {
+        if(std::ranges::all_of(vertices, [&](Vec2f p) { return boundary.isInside(p); }))
+            subPolygons.emplace_back(vertices.begin(), vertices.end());
+        else
+        if(isInsidePolygon(boundary.getCenter(), vertices))
+        {
+            auto& windowPoly = subPolygons.emplace_back();
+
+            for(const auto& [cornerPos, corner] : boundary.getCorners())
+                windowPoly.push_back(corner);
+        }
+
+        return subPolygons;
+    }
+
+    size_t k = intersections.size();
+
+    // Order along the window. When two are at the same spot, the exiting one goes first, so that a polygon
+    // touching the window from outside closes on itself rather than going around the window
+    std::vector<uint32_t> windowOrder(k);
+    std::iota(windowOrder.begin(), windowOrder.end(), 0u);
+
+    std::sort(windowOrder.begin(), windowOrder.end(), [&](uint32_t a, uint32_t b)
+    {
+        if(intersections[a].perimeterPos != intersections[b].perimeterPos)
+            return intersections[a].perimeterPos < intersections[b].perimeterPos;
+
+        return !intersections[a].isEntering && intersections[b].isEntering;
+    });
+
+    std::vector<uint32_t> nextAlongWindow(k);
+
+    for(size_t i = 0; i < k; ++i)
+        nextAlongWindow[windowOrder[i]] = windowOrder[(i + 1) % k];
 
-            for(size_t k = 0; k < clippingPoly.size(); ++k)
+    // Window corners, in the same direction as the polygon
+    auto corners = boundary.getCorners();
+
+    for(auto& [cornerPos, corner] : corners)
+        cornerPos = alongWindow(cornerPos);
+
+    std::sort(corners.begin(), corners.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // Corners strictly between two positions along the window, when wrapping around, first the ones past 'from'
+    auto addCornersBetween = [&](float from, float to, std::vector<Vec2f>& subPoly)
+    {
+        for(const auto& [cornerPos, corner] : corners)
+        {
+            if(cornerPos > from && (cornerPos < to || to < from))
+                subPoly.push_back(corner);
+        }
+
+        if(to < from)
+        {
+            for(const auto& [cornerPos, corner] : corners)
             {
-                if(numInterSamePolySeg > 2 || sameVertex)
-                    break;
-                
-                if(!clippingPoly[k].isIntersection)
-                    count++;
-                    
-                if(*intersectPos == winPoints[winNextPointIdx] && !addInterLater)
-                {
-                    if(winNextPointIdx == 0)
-                    {
-                        clippingPoly.emplace(clippingPoly.begin() + 1, Vertex{*intersectPos, vertexId, true, isEntering});
-                        break;
-                    }
-
-                    --count;
-                    addInterLater = true;
-                }
-                    
-                if(count - 1 == j)
-                {
-                    clippingPoly.emplace(clippingPoly.begin() + k + 1, Vertex{*intersectPos, vertexId, true, isEntering});
-                    break;
-                }
+                if(cornerPos < to)
+                    subPoly.push_back(corner);
             }
+        }
+    };
+
+    std::vector<uint8_t> isVisited(k);
+    size_t maxSteps = 2 * (n + k) + 8; // Guards against a broken alternation, which only bad input could cause
+
+    for(uint32_t start = 0; start < k; ++start)
+    {
+        if(!intersections[start].isEntering || isVisited[start])
+            continue;
+
+        std::vector<Vec2f> subPoly;
+        uint32_t curr = start;
+        size_t steps{};
+
+        do
+        {
+            // Along the polygon, from an entering intersection to the next one, which exits
+            const auto& entering = intersections[curr];
+            isVisited[curr] = true;
+
+            uint32_t exitIdx = (curr + 1) % k;
+            const auto& exiting = intersections[exitIdx];
+            isVisited[exitIdx] = true;
+
+            subPoly.push_back(entering.pos);
+
+            for(size_t v = 1; v <= verticesBetween(entering, exiting); ++v)
+                subPoly.push_back(vertices[(entering.edge + v) % n]);
+
+            subPoly.push_back(exiting.pos);
+
+            // Then along the window, up to the next entering one
+            uint32_t next = nextAlongWindow[exitIdx];
 
-            streakNoIntersect = 1;
+            while(!intersections[next].isEntering && steps++ < maxSteps)
+                next = nextAlongWindow[next];
 
-            didIntersect = true;
-            ++vertexId;
+            addCornersBetween(exiting.perimeterPos, intersections[next].perimeterPos, subPoly);
+
+            curr = next;
         }
-        
-        if(!didIntersect)
-            ++streakNoIntersect;
+        while(curr != start && steps++ < maxSteps);
+
+        // Whatever only runs along the border of the window has no area
+        if(subPoly.size() >= 3 && signedArea(subPoly) != 0.f)
+            subPolygons.push_back(std::move(subPoly));
     }
+
+    return subPolygons;
 }
 
-inline auto getSubPolygons(const std::vector<Vertex>& clippedPoly, const std::vector<Vertex>& clippingPoly, size_t initialSize = 2)
+} // namespace detail
+
+inline std::vector<std::vector<Vec2f>> weilerAtherton(std::span<const Vec2f> vertices, const Window& win)
 {
-    std::vector<std::vector<Vertex>> subPolygons;
-    subPolygons.reserve(initialSize); 
+    return detail::weilerAtherton(vertices, detail::WindowBoundary{win});
+}
+
+// Against any convex region, in the same coordinates as it. Its vertices stand for the window corners
+inline std::vector<std::vector<Vec2f>> weilerAtherton(std::span<const Vec2f> vertices, const ConvexRegion& region)
+{
+    return detail::weilerAtherton(vertices, detail::ConvexBoundary{region});
+}
 
-    bool addVertices{};
-    bool allVertsAdded{};
-    int enteringVertId{-1};
-    int firstEnteringVertId{-2};
+//////////////////////////////////////////////////////////////////////////////////
 
-    std::vector<Vertex> subPoly;
-    subPoly.reserve(4);
+/*
+    Sutherland Hodgman, only for convex polygons, in window coordinates. The polygon is clipped against one
+    window edge after the other, each pass walks the output of the previous one, so the result is a single
+    polygon (empty when nothing is left), computed in linear time. Both buffers are reused between calls
+*/
+inline void sutherlandHodgman(std::span<const Vec2f> vertices, const Window& win, std::vector<Vec2f>& out, std::vector<Vec2f>& scratch)
+{
+    out.assign(vertices.begin(), vertices.end());
 
-    for(size_t i = 0; i < clippedPoly.size() * 2; ++i)
+    // Edge given by the coordinate it's on (x or y), its position, and which side is kept
+    auto clipAgainst = [&](int axis, float edge, bool keepGreater)
     {
-        size_t idx = i % clippedPoly.size();
-        size_t nextIdx  = (i + 1) % clippedPoly.size();
+        std::swap(out, scratch);
+        out.clear();
 
-        if(firstEnteringVertId == clippedPoly[idx].id || allVertsAdded)
-            break;
-        
-        if(clippedPoly[idx].isIntersection && clippedPoly[idx].isEntering)
-        {
-            addVertices = true;
-            enteringVertId = clippedPoly[idx].id;
+        auto coord = [axis](Vec2f p) { return axis == 0 ? p.x : p.y; };
+        auto isInside = [&](Vec2f p) { return keepGreater ? coord(p) >= edge : coord(p) <= edge; };
 
-            if(firstEnteringVertId == -2)
-                firstEnteringVertId = enteringVertId;
-        }
-        
-        if((addVertices && clippedPoly[idx].isIntersection && !clippedPoly[idx].isEntering))
+        for(size_t i = 0; i < scratch.size(); ++i)
         {
-            bool addVerts{};
-            int countInterInARow{};
-            bool skipVertNextIter{};
-            bool anyVertexSkipped{};
+            Vec2f curr = scratch[i];
+            Vec2f next = scratch[(i + 1) % scratch.size()];
+
+            bool isCurrInside = isInside(curr);
+            bool isNextInside = isInside(next);
+
+            if(isCurrInside)
+                out.push_back(curr);
 
-            for(size_t j = 0; j < clippingPoly.size() * 2; ++j)
+            if(isCurrInside != isNextInside)
             {
-                size_t jdx = j % clippingPoly.size();
-              
-                if(clippingPoly[jdx].id == clippedPoly[idx].id)
-                    addVerts = true;
-
-                if(!addVerts)
-                    continue;
-                    
-                bool skipVertex = skipVertNextIter;
-                    
-                if(clippingPoly[jdx].isIntersection)
-                {
-                    ++countInterInARow;
-                    
-                    if(anyVertexSkipped && j == clippingPoly.size() - 1)
-                        skipVertNextIter = true;
-                }
-                else
-                {
-                    if(countInterInARow < 2)
-                        countInterInARow = 0;
-                    else
-                        skipVertex = true;
-                }
-
-                if(clippingPoly[jdx].id == firstEnteringVertId && j > clippingPoly.size())
-                    allVertsAdded = true;
-                
-                if(clippingPoly[jdx].id == enteringVertId)
-                {
-                    subPolygons.emplace_back(subPoly);
-                    subPoly.clear();
-                    addVertices = false;
-                    break;
-                }
-                else
-                {
-                    if(skipVertex) // Don't add the window corner
-                    {
-                        if(j != clippingPoly.size() - 1)
-                            countInterInARow = 0;
-                            
-                        anyVertexSkipped = true;
-                        skipVertNextIter = false;
-                        continue;
-                    }
-
-                    subPoly.emplace_back(clippingPoly[jdx]);
-                }
+                float t = (edge - coord(curr)) / (coord(next) - coord(curr));
+                Vec2f p = curr + (next - curr) * t;
+
+                // Exactly on the edge, so that rounding doesn't leave it slightly outside
+                (axis == 0 ? p.x : p.y) = edge;
+
+                out.push_back(p);
             }
         }
-        else
-        if(addVertices)
-            subPoly.emplace_back(clippedPoly[idx]);
-    }
+    };
 
-    return subPolygons;
+    clipAgainst(0, win.wmin.x, true);
+    clipAgainst(0, win.wmax.x, false);
+    clipAgainst(1, win.wmin.y, true);
+    clipAgainst(1, win.wmax.y, false);
 }
 
-// This is probably not the best approach to implement Weiler Atherton.
-// I didn't find any good implementation online, to compare mine against.
-// I used the steps mentioned at 'https://www.geeksforgeeks.org/weiler-atherton-polygon-clipping-algorithm/' as a guiding reference
-// The algorithm is not complete, there are edge cases that are not treated
-inline auto weilerAtherton(const Polygon& poly, const Window& win)
+// Same as above, against each edge of a convex region in turn, in the same coordinates as it
+inline void sutherlandHodgman(std::span<const Vec2f> vertices, const ConvexRegion& region, std::vector<Vec2f>& out, std::vector<Vec2f>& scratch)
 {
-    // We could use a std::array here, as we are only dealing with a rectangular window
-    const std::vector<Vec2f> winPoints = {win.wmin, {win.wmin.x, win.wmax.y}, win.wmax, {win.wmax.x, win.wmin.y}};
+    out.assign(vertices.begin(), vertices.end());
+
+    for(size_t edge = 0; edge < region.size() && !out.empty(); ++edge)
+    {
+        std::swap(out, scratch);
+        out.clear();
 
-    auto clippedPoly = getClippedPolyList(poly);
-    auto clippingPoly = getClippingPolyList(winPoints);
+        for(size_t i = 0; i < scratch.size(); ++i)
+        {
+            Vec2f curr = scratch[i];
+            Vec2f next = scratch[(i + 1) % scratch.size()];
 
-    placeIntersectionsInto(clippedPoly, clippingPoly, poly, winPoints);
+            float currDist = region.distance(edge, curr);
+            float nextDist = region.distance(edge, next);
 
-    sortIntersectionsForEachSegmentOf(clippingPoly);
+            if(currDist >= 0.f)
+                out.push_back(curr);
 
-    return getSubPolygons(clippedPoly, clippingPoly, poly.vertices.size() / 2);
+            if((currDist >= 0.f) != (nextDist >= 0.f))
+                out.push_back(curr + (next - curr) * (currDist / (currDist - nextDist)));
+        }
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////////////
@@ -493,7 +641,7 @@ enum RegionCode
     Left   = 0b0001,
 };
 
-void operator|= (RegionCode& code1, RegionCode code2)
+inline void operator|= (RegionCode& code1, RegionCode code2)
 {
     int c1 = static_cast<int>(code1);
     int c2 = static_cast<int>(code2);
@@ -590,6 +738,113 @@ inline std::optional<LineSeg> cohenSutherland(const Window& win, LineSeg line)
     return LineSeg{p0, p1};
 }
 
+/*
+    Batched Cohen Sutherland, over the segments (p0[i], p1[i]), in window coordinates. The outcodes of all the
+    endpoints are computed first, four at a time, which settles most segments: fully inside ones are copied
+    as they are and the ones entirely on the outer side of an edge are dropped. Only the indices of the remaining
+    ones are kept, and those alone go through the intersection loop of the scalar version.
+    Writes the clipped endpoints and whether each segment is visible (1) or not (0), same as the batched Liang Barsky
+*/
+inline LineClippingStats cohenSutherland(const Window& win, std::span<const Vec2f> p0, std::span<const Vec2f> p1,
+                                         std::span<Vec2f> outP0, std::span<Vec2f> outP1, std::span<uint8_t> isVisible)
+{
+    assert(p0.size() == p1.size() && outP0.size() == p0.size() && outP1.size() == p0.size() && isVisible.size() == p0.size());
+
+    size_t count = p0.size();
+    size_t i = 0;
+
+    LineClippingStats stats;
+    std::vector<uint32_t> needClipping;
+
+    // One segment at a time, for what's left after the vectorized pass
+    auto classify = [&](size_t idx, int code0, int code1)
+    {
+        outP0[idx] = p0[idx];
+        outP1[idx] = p1[idx];
+
+        if((code0 | code1) == In)
+        {
+            isVisible[idx] = 1;
+            ++stats.trivialAccepts;
+        }
+        else
+        if(code0 & code1)
+        {
+            isVisible[idx] = 0;
+            ++stats.trivialRejects;
+        }
+        else
+            needClipping.push_back((uint32_t) idx);
+    };
+
+#if defined(MIRRAS_AVX2) || defined(MIRRAS_SSE2)
+    const __m128 wminX = _mm_set1_ps(win.wmin.x), wminY = _mm_set1_ps(win.wmin.y);
+    const __m128 wmaxX = _mm_set1_ps(win.wmax.x), wmaxY = _mm_set1_ps(win.wmax.y);
+
+    // Same bits as RegionCode, one code per lane
+    auto outcodes = [&](__m128 x, __m128 y)
+    {
+        __m128i left   = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(x, wminX)), _mm_set1_epi32(Left));
+        __m128i right  = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(x, wmaxX)), _mm_set1_epi32(Right));
+        __m128i bottom = _mm_and_si128(_mm_castps_si128(_mm_cmplt_ps(y, wminY)), _mm_set1_epi32(Bottom));
+        __m128i top    = _mm_and_si128(_mm_castps_si128(_mm_cmpgt_ps(y, wmaxY)), _mm_set1_epi32(Top));
+
+        return _mm_or_si128(_mm_or_si128(left, right), _mm_or_si128(bottom, top));
+    };
+
+    // Endpoints are copied as they are, which is already the result for the trivially accepted segments
+    for(; i + 4 <= count; i += 4)
+    {
+        __m128 a0 = _mm_loadu_ps(&p0[i].x), b0 = _mm_loadu_ps(&p0[i + 2].x);
+        __m128 a1 = _mm_loadu_ps(&p1[i].x), b1 = _mm_loadu_ps(&p1[i + 2].x);
+
+        __m128i code0 = outcodes(_mm_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i code1 = outcodes(_mm_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1)));
+
+        __m128i zero = _mm_setzero_si128();
+        int acceptMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_or_si128(code0, code1), zero)));
+        int rejectMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(code0, code1), zero))) ^ 0b1111;
+        int clipMask = ~(acceptMask | rejectMask) & 0b1111;
+
+        _mm_storeu_ps(&outP0[i].x, a0);
+        _mm_storeu_ps(&outP0[i + 2].x, b0);
+        _mm_storeu_ps(&outP1[i].x, a1);
+        _mm_storeu_ps(&outP1[i + 2].x, b1);
+
+        for(int lane = 0; lane < 4; ++lane)
+            isVisible[i + lane] = (acceptMask >> lane) & 1;
+
+        stats.trivialAccepts += std::popcount((unsigned) acceptMask);
+        stats.trivialRejects += std::popcount((unsigned) rejectMask);
+
+        // Stream compaction of the ones left
+        for(; clipMask; clipMask &= clipMask - 1)
+            needClipping.push_back(uint32_t(i + std::countr_zero((unsigned) clipMask)));
+    }
+#endif
+
+    // Scalar fallback, also takes care of the remaining segments
+    for(; i < count; ++i)
+        classify(i, getCode(win, p0[i]), getCode(win, p1[i]));
+
+    for(uint32_t idx : needClipping)
+    {
+        auto line = cohenSutherland(win, LineSeg{p0[idx], p1[idx]});
+
+        isVisible[idx] = line.has_value();
+
+        if(line)
+        {
+            outP0[idx] = line->p0;
+            outP1[idx] = line->p1;
+        }
+    }
+
+    stats.clipped = needClipping.size();
+
+    return stats;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 inline std::optional<LineSeg> liangBarsky(const Window& win, LineSeg line)
@@ -646,4 +901,211 @@ inline std::optional<LineSeg> liangBarsky(const Window& win, LineSeg line)
     return LineSeg{{x1, y1}, {x2, y2}};
 }
 
+/*
+    Batched Liang-Barsky, over the segments (p0[i], p1[i]), in window coordinates. Writes the clipped endpoints
+    and whether each segment is visible (1) or not (0), the endpoints of the invisible ones are left unspecified.
+    The output may be the same as the input. Four segments are clipped at a time, with the p/q terms of all of
+    them computed at once and the branches of the scalar version replaced by masks. Returns the visible count
+*/
+inline size_t liangBarsky(const Window& win, std::span<const Vec2f> p0, std::span<const Vec2f> p1,
+                          std::span<Vec2f> outP0, std::span<Vec2f> outP1, std::span<uint8_t> isVisible)
+{
+    assert(p0.size() == p1.size() && outP0.size() == p0.size() && outP1.size() == p0.size() && isVisible.size() == p0.size());
+
+    size_t count = p0.size();
+    size_t visibleCount{};
+    size_t i = 0;
+
+#if defined(MIRRAS_AVX2) || defined(MIRRAS_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 wminX = _mm_set1_ps(win.wmin.x), wminY = _mm_set1_ps(win.wmin.y);
+    const __m128 wmaxX = _mm_set1_ps(win.wmax.x), wmaxY = _mm_set1_ps(win.wmax.y);
+
+    // Clips against one pair of window edges (p = -d and p = d)
+    auto clipAxis = [&](__m128 d, __m128 qMin, __m128 qMax, __m128& t1, __m128& t2, __m128& rejected)
+    {
+        __m128 negD = _mm_sub_ps(zero, d);
+
+        __m128 rMin = _mm_div_ps(qMin, negD);
+        __m128 rMax = _mm_div_ps(qMax, d);
+
+        // d > 0: the min edge is entering (p < 0) and the max edge is leaving (p > 0), the other way around otherwise
+        __m128 isPositive = _mm_cmpgt_ps(d, zero);
+        __m128 isNegative = _mm_cmplt_ps(d, zero);
+        __m128 isParallel = _mm_cmpeq_ps(d, zero);
+
+        __m128 entering = _mm_or_ps(_mm_and_ps(isPositive, rMin), _mm_and_ps(isNegative, rMax));
+        __m128 leaving  = _mm_or_ps(_mm_and_ps(isPositive, rMax), _mm_and_ps(isNegative, rMin));
+
+        // Both are 0 in parallel lanes, which only reject when outside, so t2 is kept as is with a 1 instead
+        t1 = _mm_max_ps(t1, entering);
+        t2 = _mm_min_ps(t2, _mm_or_ps(_mm_and_ps(isParallel, one), leaving));
+
+        __m128 outside = _mm_or_ps(_mm_cmplt_ps(qMin, zero), _mm_cmplt_ps(qMax, zero));
+        rejected = _mm_or_ps(rejected, _mm_and_ps(isParallel, outside));
+    };
+
+    for(; i + 4 <= count; i += 4)
+    {
+        // (x, y) pairs to 4 xs and 4 ys
+        __m128 a0 = _mm_loadu_ps(&p0[i].x), b0 = _mm_loadu_ps(&p0[i + 2].x);
+        __m128 a1 = _mm_loadu_ps(&p1[i].x), b1 = _mm_loadu_ps(&p1[i + 2].x);
+
+        __m128 x0 = _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)), y0 = _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 x1 = _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)), y1 = _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 dx = _mm_sub_ps(x1, x0);
+        __m128 dy = _mm_sub_ps(y1, y0);
+
+        __m128 t1 = zero, t2 = one, rejected = zero;
+
+        clipAxis(dx, _mm_sub_ps(x0, wminX), _mm_sub_ps(wmaxX, x0), t1, t2, rejected);
+        clipAxis(dy, _mm_sub_ps(y0, wminY), _mm_sub_ps(wmaxY, y0), t1, t2, rejected);
+
+        __m128 visible = _mm_andnot_ps(rejected, _mm_cmple_ps(t1, t2));
+
+        __m128 cx0 = _mm_add_ps(x0, _mm_mul_ps(t1, dx)), cy0 = _mm_add_ps(y0, _mm_mul_ps(t1, dy));
+        __m128 cx1 = _mm_add_ps(x0, _mm_mul_ps(t2, dx)), cy1 = _mm_add_ps(y0, _mm_mul_ps(t2, dy));
+
+        // Back to (x, y) pairs
+        _mm_storeu_ps(&outP0[i].x,     _mm_unpacklo_ps(cx0, cy0));
+        _mm_storeu_ps(&outP0[i + 2].x, _mm_unpackhi_ps(cx0, cy0));
+        _mm_storeu_ps(&outP1[i].x,     _mm_unpacklo_ps(cx1, cy1));
+        _mm_storeu_ps(&outP1[i + 2].x, _mm_unpackhi_ps(cx1, cy1));
+
+        int mask = _mm_movemask_ps(visible);
+
+        for(int lane = 0; lane < 4; ++lane)
+            isVisible[i + lane] = (mask >> lane) & 1;
+
+        visibleCount += std::popcount((unsigned) mask);
+    }
+#endif
+
+    // Scalar fallback, also takes care of the remaining segments
+    for(; i < count; ++i)
+    {
+        auto line = liangBarsky(win, LineSeg{p0[i], p1[i]});
+
+        isVisible[i] = line.has_value();
+
+        if(line)
+        {
+            outP0[i] = line->p0;
+            outP1[i] = line->p1;
+            ++visibleCount;
+        }
+    }
+
+    return visibleCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Against any convex region, in the same coordinates as it. Like Liang Barsky, with the edge normals in place of the axes
+inline std::optional<LineSeg> cyrusBeck(const ConvexRegion& region, LineSeg line)
+{
+    auto[t0, t1] = detail::insideInterval(line.p0, line.p1, region);
+
+    if(t0 > t1)
+        return {};
+
+    Vec2f d = line.p1 - line.p0;
+
+    return LineSeg{line.p0 + d * t0, line.p0 + d * t1};
+}
+
+/*
+    Batched Cyrus Beck, over the segments (p0[i], p1[i]), against a convex region, which lets the window be clipped
+    against where it is in the world, rotated or not, without taking every segment to window coordinates first.
+    Same contract as the batched Liang Barsky: writes the clipped endpoints and whether each segment is visible,
+    the output may be the same as the input. Four segments are clipped at a time, one region edge after the other,
+    with the branches replaced by masks. Returns the visible count
+*/
+inline size_t cyrusBeck(const ConvexRegion& region, std::span<const Vec2f> p0, std::span<const Vec2f> p1,
+                        std::span<Vec2f> outP0, std::span<Vec2f> outP1, std::span<uint8_t> isVisible)
+{
+    assert(p0.size() == p1.size() && outP0.size() == p0.size() && outP1.size() == p0.size() && isVisible.size() == p0.size());
+
+    size_t count = p0.size();
+    size_t visibleCount{};
+    size_t i = 0;
+
+#if defined(MIRRAS_AVX2) || defined(MIRRAS_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+
+    for(; i + 4 <= count; i += 4)
+    {
+        // (x, y) pairs to 4 xs and 4 ys
+        __m128 a0 = _mm_loadu_ps(&p0[i].x), b0 = _mm_loadu_ps(&p0[i + 2].x);
+        __m128 a1 = _mm_loadu_ps(&p1[i].x), b1 = _mm_loadu_ps(&p1[i + 2].x);
+
+        __m128 x0 = _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(2, 0, 2, 0)), y0 = _mm_shuffle_ps(a0, b0, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 x1 = _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(2, 0, 2, 0)), y1 = _mm_shuffle_ps(a1, b1, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 dx = _mm_sub_ps(x1, x0);
+        __m128 dy = _mm_sub_ps(y1, y0);
+
+        __m128 t0 = zero, t1 = one, rejected = zero;
+
+        for(size_t edge = 0; edge < region.size(); ++edge)
+        {
+            __m128 nx = _mm_set1_ps(region.normals[edge].x), ny = _mm_set1_ps(region.normals[edge].y);
+
+            __m128 dist = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(nx, x0), _mm_mul_ps(ny, y0)), _mm_set1_ps(region.offsets[edge]));
+            __m128 speed = _mm_add_ps(_mm_mul_ps(nx, dx), _mm_mul_ps(ny, dy));
+
+            __m128 t = _mm_div_ps(_mm_sub_ps(zero, dist), speed);
+
+            __m128 isEntering = _mm_cmpgt_ps(speed, zero);
+            __m128 isLeaving  = _mm_cmplt_ps(speed, zero);
+            __m128 isParallel = _mm_cmpeq_ps(speed, zero);
+
+            // The lanes that don't enter or leave through this edge get a t that doesn't change anything
+            t0 = _mm_max_ps(t0, _mm_and_ps(isEntering, t));
+            t1 = _mm_min_ps(t1, _mm_or_ps(_mm_and_ps(isLeaving, t), _mm_andnot_ps(isLeaving, one)));
+
+            rejected = _mm_or_ps(rejected, _mm_and_ps(isParallel, _mm_cmplt_ps(dist, zero)));
+        }
+
+        __m128 visible = _mm_andnot_ps(rejected, _mm_cmple_ps(t0, t1));
+
+        __m128 cx0 = _mm_add_ps(x0, _mm_mul_ps(t0, dx)), cy0 = _mm_add_ps(y0, _mm_mul_ps(t0, dy));
+        __m128 cx1 = _mm_add_ps(x0, _mm_mul_ps(t1, dx)), cy1 = _mm_add_ps(y0, _mm_mul_ps(t1, dy));
+
+        // Back to (x, y) pairs
+        _mm_storeu_ps(&outP0[i].x,     _mm_unpacklo_ps(cx0, cy0));
+        _mm_storeu_ps(&outP0[i + 2].x, _mm_unpackhi_ps(cx0, cy0));
+        _mm_storeu_ps(&outP1[i].x,     _mm_unpacklo_ps(cx1, cy1));
+        _mm_storeu_ps(&outP1[i + 2].x, _mm_unpackhi_ps(cx1, cy1));
+
+        int mask = _mm_movemask_ps(visible);
+
+        for(int lane = 0; lane < 4; ++lane)
+            isVisible[i + lane] = (mask >> lane) & 1;
+
+        visibleCount += std::popcount((unsigned) mask);
+    }
+#endif
+
+    // Scalar fallback, also takes care of the remaining segments
+    for(; i < count; ++i)
+    {
+        auto line = cyrusBeck(region, LineSeg{p0[i], p1[i]});
+
+        isVisible[i] = line.has_value();
+
+        if(line)
+        {
+            outP0[i] = line->p0;
+            outP1[i] = line->p1;
+            ++visibleCount;
+        }
+    }
+
+    return visibleCount;
+}
+
 } // namespace mirras
\ No newline at end of file
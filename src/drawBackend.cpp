@@ -0,0 +1,127 @@
+#include "drawBackend.h"
+
+#include <imgui_internal.h> // For the white pixel of the font atlas and the width of the anti-aliasing fringe
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace mirras
+{
+/*
+    Each point is a square around its center, as large as the ring it stands for. When anti-aliased, it is surrounded
+    by a fringe fading out, a second square joined to the first by a quad on each side
+*/
+void ImGuiDrawBackend::addPoints(std::span<const Vec2f> centers, std::span<const uint32_t> colors, float radius, float thickness)
+{
+    bool isAntiAliased = draw_list->Flags & ImDrawListFlags_AntiAliasedLines;
+    float fringe = isAntiAliased ? draw_list->_FringeScale : 0.f;
+
+    // Same extent as an outline of that thickness, the fringe taking half a pixel on each side
+    float innerSize = radius + std::max(thickness - fringe, 0.f) / 2.f;
+    float outerSize = innerSize + fringe;
+
+    const Vec2f corners[] = {{-1.f, -1.f}, {1.f, -1.f}, {1.f, 1.f}, {-1.f, 1.f}};
+
+    const unsigned vtxPerPoint = isAntiAliased ? 8 : 4;
+    const unsigned idxPerPoint = isAntiAliased ? 30 : 6;
+    const size_t maxBatchSize = std::numeric_limits<ImDrawIdx>::max() / vtxPerPoint;
+
+    ImVec2 uv = draw_list->_Data->TexUvWhitePixel;
+
+    for(size_t first = 0; first < centers.size(); first += maxBatchSize)
+    {
+        size_t last = std::min(first + maxBatchSize, centers.size());
+
+        draw_list->PrimReserve(int((last - first) * idxPerPoint), int((last - first) * vtxPerPoint));
+
+        ImDrawVert* vtx = draw_list->_VtxWritePtr;
+        ImDrawIdx* idx = draw_list->_IdxWritePtr;
+        unsigned base = draw_list->_VtxCurrentIdx;
+
+        for(size_t i = first; i < last; ++i)
+        {
+            for(auto corner : corners)
+                *vtx++ = {centers[i] + corner * innerSize, uv, colors[i]};
+
+            idx[0] = ImDrawIdx(base); idx[1] = ImDrawIdx(base + 1); idx[2] = ImDrawIdx(base + 2);
+            idx[3] = ImDrawIdx(base); idx[4] = ImDrawIdx(base + 2); idx[5] = ImDrawIdx(base + 3);
+            idx += 6;
+
+            if(isAntiAliased)
+            {
+                uint32_t transparent = colors[i] & ~IM_COL32_A_MASK;
+
+                for(auto corner : corners)
+                    *vtx++ = {centers[i] + corner * outerSize, uv, transparent};
+
+                for(unsigned c = 0; c < 4; ++c)
+                {
+                    unsigned next = (c + 1) % 4;
+
+                    idx[0] = ImDrawIdx(base + c); idx[1] = ImDrawIdx(base + next); idx[2] = ImDrawIdx(base + 4 + next);
+                    idx[3] = ImDrawIdx(base + c); idx[4] = ImDrawIdx(base + 4 + next); idx[5] = ImDrawIdx(base + 4 + c);
+                    idx += 6;
+                }
+            }
+
+            base += vtxPerPoint;
+        }
+
+        draw_list->_VtxWritePtr = vtx;
+        draw_list->_IdxWritePtr = idx;
+        draw_list->_VtxCurrentIdx = base;
+    }
+}
+
+bool DrawRecorder::isSameAs(const DrawRecorder& other) const
+{
+    if(primitives.size() != other.primitives.size() || vertices.size() != other.vertices.size())
+        return false;
+
+    for(size_t i = 0; i < primitives.size(); ++i)
+    {
+        const auto& a = primitives[i];
+        const auto& b = other.primitives[i];
+
+        if(a.type != b.type || a.color != b.color || a.thickness != b.thickness || a.radius != b.radius ||
+           a.firstVertex != b.firstVertex || a.vertexCount != b.vertexCount)
+            return false;
+    }
+
+    return std::memcmp(vertices.data(), other.vertices.data(), vertices.size() * sizeof(Vec2f)) == 0;
+}
+
+// FNV-1a, over the fields rather than the structs, whose padding isn't initialized
+uint64_t DrawRecorder::getDigest() const
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    auto add = [&](const auto& value)
+    {
+        unsigned char bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+
+        for(auto byte : bytes)
+            hash = (hash ^ byte) * 1099511628211ull;
+    };
+
+    for(const auto& primitive : primitives)
+    {
+        add(primitive.type);
+        add(primitive.color);
+        add(primitive.thickness);
+        add(primitive.radius);
+        add(primitive.vertexCount);
+    }
+
+    for(const auto& v : vertices)
+    {
+        add(v.x);
+        add(v.y);
+    }
+
+    return hash;
+}
+
+} // namespace mirras
\ No newline at end of file
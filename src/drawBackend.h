@@ -0,0 +1,138 @@
+#pragma once
+
+#include "vec2f.h"
+
+#include <imgui.h>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mirras
+{
+/*
+    What the objects are drawn with. The arrays only ever draw these three kinds of primitives, with their
+    coordinates already taken to the draw area, so a backend doesn't need to know anything about the objects
+*/
+class DrawBackend
+{
+public:
+    virtual ~DrawBackend() = default;
+
+    virtual void addPoint(Vec2f center, float radius, uint32_t color, float thickness) = 0;
+
+    // Many points at once, colors[i] being the color of centers[i]
+    virtual void addPoints(std::span<const Vec2f> centers, std::span<const uint32_t> colors, float radius, float thickness)
+    {
+        for(size_t i = 0; i < centers.size(); ++i)
+            addPoint(centers[i], radius, colors[i], thickness);
+    }
+
+    virtual void addLine(Vec2f p0, Vec2f p1, uint32_t color, float thickness) = 0;
+    virtual void addClosedPolyline(std::span<const Vec2f> vertices, uint32_t color, float thickness) = 0;
+
+    // For what works on ImGui's draw list directly, like the DrawListCache, null when there is none behind
+    virtual ImDrawList* getImDrawList() { return nullptr; }
+};
+
+/*
+    Points are drawn as small squares, written straight into the draw list, as many points per PrimReserve as 16 bit
+    indices allow. Going through AddCircle for each point would build a path and find the normals of its outline every
+    time, and turn a dot of a few pixels into a ring of a couple dozen vertices
+*/
+class ImGuiDrawBackend : public DrawBackend
+{
+public:
+    explicit ImGuiDrawBackend(ImDrawList* drawList) : draw_list(drawList) {}
+
+    void addPoint(Vec2f center, float radius, uint32_t color, float thickness) override
+    {
+        addPoints({&center, 1}, {&color, 1}, radius, thickness);
+    }
+
+    void addPoints(std::span<const Vec2f> centers, std::span<const uint32_t> colors, float radius, float thickness) override;
+
+    void addLine(Vec2f p0, Vec2f p1, uint32_t color, float thickness) override
+    {
+        draw_list->AddLine(p0, p1, color, thickness);
+    }
+
+    void addClosedPolyline(std::span<const Vec2f> vertices, uint32_t color, float thickness) override
+    {
+        static_assert(sizeof(Vec2f) == sizeof(ImVec2));
+
+        draw_list->AddPolyline(reinterpret_cast<const ImVec2*>(vertices.data()), (int) vertices.size(), color, ImDrawFlags_Closed, thickness);
+    }
+
+    ImDrawList* getImDrawList() override { return draw_list; }
+
+private:
+    ImDrawList* draw_list{};
+};
+
+/*
+    Keeps the primitives instead of drawing them, in flat arrays, so that the whole drawing path can run, be timed
+    and have its output compared without a window nor an OpenGL context. The vertices of every primitive are stored
+    one after the other, a point having a single one
+*/
+class DrawRecorder : public DrawBackend
+{
+public:
+    enum class PrimitiveType : uint8_t
+    {
+        Point,
+        Line,
+        ClosedPolyline
+    };
+
+    struct Primitive
+    {
+        PrimitiveType type{};
+        uint32_t color{};
+        float thickness{};
+        float radius{}; // Points only
+        uint32_t firstVertex{};
+        uint32_t vertexCount{};
+    };
+
+    void addPoint(Vec2f center, float radius, uint32_t color, float thickness) override
+    {
+        primitives.push_back({PrimitiveType::Point, color, thickness, radius, (uint32_t) vertices.size(), 1});
+        vertices.push_back(center);
+    }
+
+    void addLine(Vec2f p0, Vec2f p1, uint32_t color, float thickness) override
+    {
+        primitives.push_back({PrimitiveType::Line, color, thickness, 0.f, (uint32_t) vertices.size(), 2});
+        vertices.push_back(p0);
+        vertices.push_back(p1);
+    }
+
+    void addClosedPolyline(std::span<const Vec2f> polyVertices, uint32_t color, float thickness) override
+    {
+        primitives.push_back({PrimitiveType::ClosedPolyline, color, thickness, 0.f, (uint32_t) vertices.size(), (uint32_t) polyVertices.size()});
+        vertices.insert(vertices.end(), polyVertices.begin(), polyVertices.end());
+    }
+
+    std::span<const Vec2f> getVertices(const Primitive& primitive) const
+    {
+        return std::span{vertices}.subspan(primitive.firstVertex, primitive.vertexCount);
+    }
+
+    // Same primitives, in the same order, with exactly the same coordinates
+    bool isSameAs(const DrawRecorder& other) const;
+
+    // Hash of everything recorded, to check the output against a known good one without storing it
+    uint64_t getDigest() const;
+
+    void clear()
+    {
+        primitives.clear();
+        vertices.clear();
+    }
+
+    std::vector<Primitive> primitives;
+    std::vector<Vec2f> vertices;
+};
+
+} // namespace mirras
\ No newline at end of file
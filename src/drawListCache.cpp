@@ -0,0 +1,237 @@
+#include "drawListCache.h"
+#include "graphics.h"
+
+#include <imgui_internal.h> // The draw list state the tessellation depends on
+
+#include <algorithm>
+
+namespace mirras
+{
+DrawListCache::Key DrawListCache::makeKey(const World& world, const DrawTarget& target, const ImDrawList* drawList)
+{
+    return {
+        .worldId = world.getId(),
+        .windowVersion = target.window->version,
+        .viewportVersion = target.viewport->version,
+        .clipping = target.clipping,
+        .thickness = target.thickness,
+        .pointColor = Point::color,
+        .lineColor = LineSegment::color,
+        .polygonColor = Polygon::color,
+        .drawListFlags = drawList->Flags,
+        .texUvWhitePixel = drawList->_Data->TexUvWhitePixel,
+        .fringeScale = drawList->_FringeScale,
+        .circleMaxError = drawList->_Data->CircleSegmentMaxError
+    };
+}
+
+DrawListStats DrawListCache::draw(World& world, const DrawTarget& target)
+{
+    drawList = target.backend->getImDrawList();
+
+    // Nothing to take the geometry from
+    if(!drawList)
+    {
+        drawObjects(world, target);
+        return {.tessellatedObjects = world.getVisibleObjects().size(), .wasRebuilt = true};
+    }
+
+    auto currentKey = makeKey(world, target, drawList);
+    bool wereListed = world.takeChangedObjects(changedObjs);
+
+    size_t leftOut = uncachedObjs.size() + changedObjs.size();
+
+    if(!isFilled || !wereListed || currentKey != key || leftOut > std::max(minUncachedObjects, cachedCount / 8))
+    {
+        key = currentKey;
+        rebuild(world, target);
+
+        return {.tessellatedObjects = world.getVisibleObjects().size(), .wasRebuilt = true};
+    }
+
+    for(auto handle : changedObjs)
+        uncache(handle);
+
+    replay(target);
+
+    return drawUncached(world, target);
+}
+
+/*
+    Draws the visible objects as usual, with the arrays reporting each object as they go, so that what they added
+    to the draw list is copied into the chunks. The selected objects are left out, to be drawn on every frame
+*/
+void DrawListCache::rebuild(World& world, const DrawTarget& target)
+{
+    chunks.clear();
+    chunks.emplace_back();
+    slotRanges.clear();
+    uncachedGenerations.clear();
+    uncachedObjs.clear();
+    cachedCount = 0;
+
+    fillingWorld = &world;
+    drawPos = target.currentDrawPos;
+    capturedVtxEnd = drawList->VtxBuffer.Size;
+    capturedIdxEnd = drawList->IdxBuffer.Size;
+
+    auto fillingTarget = target;
+    fillingTarget.cache = this;
+
+    drawObjects(world, fillingTarget);
+
+    fillingWorld = nullptr;
+    isFilled = true;
+}
+
+void DrawListCache::captureObject(ObjectRef ref)
+{
+    assert(fillingWorld);
+
+    int vtxEnd = drawList->VtxBuffer.Size;
+    int idxEnd = drawList->IdxBuffer.Size;
+    int vtxCount = vtxEnd - capturedVtxEnd;
+    int idxCount = idxEnd - capturedIdxEnd;
+
+    auto handle = fillingWorld->getHandle(ref);
+    resizeSlots(handle.idx);
+
+    if(fillingWorld->isSelected(ref) || (size_t) vtxCount > maxChunkVertices)
+    {
+        uncachedGenerations[handle.idx] = handle.generation + 1;
+        uncachedObjs.push_back(handle);
+    }
+    else if(idxCount > 0)
+    {
+        if(chunks.back().vertices.size() + vtxCount > maxChunkVertices)
+            chunks.emplace_back();
+
+        auto& chunk = chunks.back();
+        auto firstVtx = chunk.vertices.size();
+        auto firstIdx = chunk.indices.size();
+
+        slotRanges[handle.idx] = {(uint32_t) chunks.size() - 1, (uint32_t) firstIdx, (uint32_t) idxCount};
+        ++cachedCount;
+
+        for(int v = capturedVtxEnd; v < vtxEnd; ++v)
+        {
+            auto vertex = drawList->VtxBuffer[v];
+            vertex.pos.x -= drawPos.x;
+            vertex.pos.y -= drawPos.y;
+            chunk.vertices.push_back(vertex);
+        }
+
+        // The indices are relative to the vertex offset of the draw command they belong to, which changes
+        // whenever ImGui runs out of 16 bit indices, so they're taken back to the vertex buffer first
+        chunk.indices.resize(firstIdx + idxCount);
+        int cmd = drawList->CmdBuffer.Size - 1;
+
+        for(int k = idxEnd - 1; k >= capturedIdxEnd; --k)
+        {
+            while(drawList->CmdBuffer[cmd].IdxOffset > (unsigned) k)
+                --cmd;
+
+            auto vtx = drawList->IdxBuffer[k] + drawList->CmdBuffer[cmd].VtxOffset - capturedVtxEnd;
+            chunk.indices[firstIdx + (k - capturedIdxEnd)] = (ImDrawIdx) (firstVtx + vtx);
+        }
+    }
+
+    capturedVtxEnd = vtxEnd;
+    capturedIdxEnd = idxEnd;
+}
+
+void DrawListCache::replay(const DrawTarget& target) const
+{
+    Vec2f offset = target.currentDrawPos;
+
+    for(const auto& chunk : chunks)
+    {
+        if(chunk.indices.empty())
+            continue;
+
+        drawList->PrimReserve((int) chunk.indices.size(), (int) chunk.vertices.size());
+
+        for(auto vertex : chunk.vertices)
+        {
+            vertex.pos.x += offset.x;
+            vertex.pos.y += offset.y;
+            *drawList->_VtxWritePtr++ = vertex;
+        }
+
+        auto firstVtx = (ImDrawIdx) drawList->_VtxCurrentIdx;
+
+        for(auto idx : chunk.indices)
+            *drawList->_IdxWritePtr++ = firstVtx + idx;
+
+        drawList->_VtxCurrentIdx += (unsigned) chunk.vertices.size();
+    }
+}
+
+DrawListStats DrawListCache::drawUncached(const World& world, const DrawTarget& target)
+{
+    const auto& visibleObjs = world.getVisibleObjects();
+
+    uncachedVisible.points.clear();
+    uncachedVisible.lines.clear();
+    uncachedVisible.polygons.clear();
+
+    for(auto handle : uncachedObjs)
+    {
+        if(!world.isAlive(handle))
+            continue;
+
+        auto ref = world.getRef(handle);
+
+        auto addIfVisible = [&](const auto& visible, auto& uncached)
+        {
+            if(std::ranges::binary_search(visible, ref.idx))
+                uncached.push_back(ref.idx);
+        };
+
+        switch(ref.type)
+        {
+        case ObjectType::Point:       addIfVisible(visibleObjs.points, uncachedVisible.points); break;
+        case ObjectType::LineSegment: addIfVisible(visibleObjs.lines, uncachedVisible.lines); break;
+        case ObjectType::Polygon:     addIfVisible(visibleObjs.polygons, uncachedVisible.polygons); break;
+        }
+    }
+
+    world.points.draw(target, uncachedVisible.points);
+    world.lines.draw(target, uncachedVisible.lines);
+    world.polygons.draw(target, uncachedVisible.polygons);
+
+    return {.tessellatedObjects = uncachedVisible.size()};
+}
+
+// Its triangles are collapsed in place, so that the rest of the chunk stays as it is
+void DrawListCache::uncache(ObjectHandle handle)
+{
+    resizeSlots(handle.idx);
+
+    auto& range = slotRanges[handle.idx];
+
+    if(range.idxCount > 0)
+    {
+        std::fill_n(chunks[range.chunk].indices.begin() + range.firstIdx, range.idxCount, ImDrawIdx{0});
+        range = {};
+        --cachedCount;
+    }
+
+    // A slot reused by a new object has it listed too, the old one is skipped once removed
+    if(uncachedGenerations[handle.idx] != handle.generation + 1)
+    {
+        uncachedGenerations[handle.idx] = handle.generation + 1;
+        uncachedObjs.push_back(handle);
+    }
+}
+
+void DrawListCache::resizeSlots(uint32_t slot)
+{
+    if(slot >= slotRanges.size())
+    {
+        slotRanges.resize(slot + 1);
+        uncachedGenerations.resize(slot + 1);
+    }
+}
+
+} // namespace mirras
\ No newline at end of file
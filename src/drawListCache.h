@@ -0,0 +1,102 @@
+#pragma once
+
+#include "representation.h"
+
+#include <imgui.h>
+
+#include <limits>
+#include <vector>
+
+namespace mirras
+{
+struct DrawTarget;
+
+struct DrawListStats
+{
+    size_t tessellatedObjects{}; // Drawn through ImGui this frame, the rest was copied from the cache
+    bool wasRebuilt{};
+};
+
+/*
+    Keeps the geometry ImGui tessellated for the visible objects, so that a frame in which nothing changed copies it
+    back into the draw list, instead of going through AddLine, AddPolyline and AddCircle for each object again.
+    While the cache is filled, the vertices and indices of each object are cut out of the draw list right after
+    it's drawn, and kept by its slot. Objects changed afterwards (see World::takeChangedObjects) have their cached
+    triangles collapsed and are drawn as usual on every frame, as are the selected ones, so that editing or selecting
+    a few objects doesn't throw the whole cache away. Once too many of them are left out, the cache is filled again.
+    The vertices are grouped in chunks small enough for 16 bit indices, each of them copied with a single PrimReserve
+*/
+class DrawListCache
+{
+public:
+    // Draws the visible objects of the world, which must be ready to be drawn as in drawObjects
+    DrawListStats draw(World& world, const DrawTarget& target);
+
+    // Called by the arrays right after drawing each object, while the cache is being filled
+    void captureObject(ObjectRef ref);
+
+private:
+    static constexpr size_t maxChunkVertices = std::numeric_limits<ImDrawIdx>::max();
+    static constexpr size_t minUncachedObjects = 256;
+
+    // Everything the tessellated geometry depends on, besides the objects themselves
+    struct Key
+    {
+        uint64_t worldId{};
+        uint64_t windowVersion{};
+        uint64_t viewportVersion{};
+        ClippingOptions clipping;
+        float thickness{};
+        uint32_t pointColor{}, lineColor{}, polygonColor{};
+        ImDrawListFlags drawListFlags{};
+        Vec2f texUvWhitePixel;
+        float fringeScale{};
+        float circleMaxError{};
+
+        friend bool operator==(const Key&, const Key&) = default;
+    };
+
+    struct Chunk
+    {
+        std::vector<ImDrawVert> vertices; // Relative to the draw position
+        std::vector<ImDrawIdx> indices;   // Within the chunk
+    };
+
+    struct CachedRange
+    {
+        uint32_t chunk{};
+        uint32_t firstIdx{};
+        uint32_t idxCount{};
+    };
+
+    static Key makeKey(const World& world, const DrawTarget& target, const ImDrawList* drawList);
+
+    void rebuild(World& world, const DrawTarget& target);
+    void replay(const DrawTarget& target) const;
+    DrawListStats drawUncached(const World& world, const DrawTarget& target);
+    void uncache(ObjectHandle handle);
+    void resizeSlots(uint32_t slot);
+
+    Key key;
+    bool isFilled{};
+
+    std::vector<Chunk> chunks;
+    std::vector<CachedRange> slotRanges;     // Empty for the objects not in the chunks
+    std::vector<uint32_t> uncachedGenerations; // One past the generation of the object left out, zero if none
+    std::vector<ObjectHandle> uncachedObjs;  // Drawn on every frame, some of them might have been removed since
+    size_t cachedCount{};
+
+    // Scratch
+    std::vector<ObjectHandle> changedObjs;
+    ObjectsInRegion uncachedVisible;
+
+    ImDrawList* drawList{}; // Of the frame being drawn
+
+    // While filling
+    const World* fillingWorld{};
+    Vec2f drawPos;
+    int capturedVtxEnd{};
+    int capturedIdxEnd{};
+};
+
+} // namespace mirras
\ No newline at end of file
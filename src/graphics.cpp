@@ -1,4 +1,6 @@
 #include "graphics.h"
+#include "imageExport.h"
+#include "redrawTracker.h"
 
 #include <string>
 
@@ -98,6 +100,7 @@ void ImGuiFileMenu(bool& wasFileLoaded)
             wasFileLoaded = true;
 
             g_World = std::move(data->world);
+            g_SelectedObjs.clear(); // Handles don't carry over to other worlds
             g_Window = data->window;
             g_Viewport = data->viewport;
         }
@@ -111,13 +114,69 @@ void ImGuiFileMenu(bool& wasFileLoaded)
     ImGuiSaveFilePopup("Save File");
 }
 
-void ImGuiUIForObjControl(int objIdx)
+/*
+    The selected objects are flagged in the world, so that they're drawn highlighted, and listed apart,
+    so that the controls reach them without going through the whole world
+*/
+static void selectObject(ObjectRef ref)
 {
-    ImGui::Text("Controls");
+    if(g_World.isSelected(ref))
+        return;
+
+    g_World.setSelected(ref, true);
+    g_SelectedObjs.push_back(g_World.getHandle(ref));
+}
+
+static void deselectObject(ObjectRef ref)
+{
+    g_World.setSelected(ref, false);
+    std::erase(g_SelectedObjs, g_World.getHandle(ref));
+}
+
+static void clearSelection()
+{
+    for(auto handle : g_SelectedObjs)
+    {
+        if(g_World.isAlive(handle))
+            g_World.setSelected(g_World.getRef(handle), false);
+    }
+
+    g_SelectedObjs.clear();
+}
+
+// Rotations and scales are around it. For several objects, the center of the box around all of them
+static Vec2f getSelectionCenter()
+{
+    if(g_SelectedObjs.size() == 1 && g_World.isAlive(g_SelectedObjs[0]))
+        return g_World.getCenter(g_World.getRef(g_SelectedObjs[0]));
+
+    Bounds box{{FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX}};
+
+    for(auto handle : g_SelectedObjs)
+    {
+        if(!g_World.isAlive(handle))
+            continue;
+
+        auto objBox = g_World.getBounds(g_World.getRef(handle));
+
+        box.min = {std::min(box.min.x, objBox.min.x), std::min(box.min.y, objBox.min.y)};
+        box.max = {std::max(box.max.x, objBox.max.x), std::max(box.max.y, objBox.max.y)};
+    }
+
+    return (box.min + box.max) / 2.f;
+}
+
+// Acts on all the selected objects at once
+void ImGuiUIForObjControl()
+{
+    if(g_SelectedObjs.size() == 1)
+        ImGui::Text("Controls");
+    else
+        ImGui::Text("Controls (%zu objects)", g_SelectedObjs.size());
 
     float currentCursorPosX = ImGui::GetCursorPosX();
 
-    static glm::mat4 transform{1.f};
+    static Affine2D transform;
     static float translationX{}, translationY{}; // Just for visualization
     
     // Calculate the transformations as they are requested, so that when we apply them, the order will be preserved
@@ -125,13 +184,13 @@ void ImGuiUIForObjControl(int objIdx)
     if(ImGuiAlignedButton(ButtonType::Arrow, "up", 0.5f, ImGuiDir_Up))
     {
         translationY += translationStep;
-        transform = glm::translate(transform, glm::vec3(0.f, translationStep, 0.f));
+        transform = transform * Affine2D::translation({0.f, translationStep});
     }
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "left", 0.25f, ImGuiDir_Left))
     {
         translationX -= translationStep;
-        transform = glm::translate(transform, glm::vec3(-translationStep, 0.f, 0.f));
+        transform = transform * Affine2D::translation({-translationStep, 0.f});
     }
     
     ImGui::SameLine();
@@ -140,13 +199,13 @@ void ImGuiUIForObjControl(int objIdx)
     if(ImGuiAlignedButton(ButtonType::Arrow, "right", 0.75f, ImGuiDir_Right))
     {
         translationX += translationStep;
-        transform = glm::translate(transform, glm::vec3(translationStep, 0.f, 0.f));
+        transform = transform * Affine2D::translation({translationStep, 0.f});
     }
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "down", 0.5f, ImGuiDir_Down))
     {
         translationY -= translationStep;
-        transform = glm::translate(transform, glm::vec3(0.f, -translationStep, 0.f));
+        transform = transform * Affine2D::translation({0.f, -translationStep});
     }
     
     static float angle{};
@@ -159,7 +218,7 @@ void ImGuiUIForObjControl(int objIdx)
     {
         angle += angleStep;
 
-        center = g_World.objects[objIdx]->getCenter();
+        center = getSelectionCenter();
         transform = transform * rotateAroundCenter(center, angleStep);
     }
 
@@ -169,7 +228,7 @@ void ImGuiUIForObjControl(int objIdx)
     {
         angle -= angleStep;
 
-        center = g_World.objects[objIdx]->getCenter();
+        center = getSelectionCenter();
         transform = transform * rotateAroundCenter(center, -angleStep);
     }
 
@@ -179,7 +238,7 @@ void ImGuiUIForObjControl(int objIdx)
     {
         scaleFactor *= 1.f + scaleFactorStep;
 
-        center = g_World.objects[objIdx]->getCenter();
+        center = getSelectionCenter();
         transform = transform * scaleAroundCenter(center, 1 + scaleFactorStep);
     }
 
@@ -189,7 +248,7 @@ void ImGuiUIForObjControl(int objIdx)
     {
         scaleFactor *= 1.f / (1.f + scaleFactorStep);
 
-        center = g_World.objects[objIdx]->getCenter();
+        center = getSelectionCenter();
         transform = transform * scaleAroundCenter(center, 1 / (1 + scaleFactorStep));
     }
 
@@ -204,7 +263,7 @@ void ImGuiUIForObjControl(int objIdx)
 
     if(ImGui::Button("Apply", buttonSize))
     {
-        g_World.objects[objIdx]->applyTransform(transform);
+        g_World.applyTransform(g_SelectedObjs, transform);
     }
 
     ImGui::SameLine();
@@ -215,7 +274,7 @@ void ImGuiUIForObjControl(int objIdx)
         translationY = 0.f;
         angle = 0.f;
         scaleFactor = 1.f;
-        transform = glm::mat4(1.f);
+        transform = {};
     }
 }
 
@@ -226,7 +285,7 @@ void ImGuiAddObjectPopup(const char* str_id)
 
     if(ImGui::BeginPopup(str_id))
     {
-        static std::vector<Point> newObjPoints{Point{}};
+        static std::vector<Vec2f> newObjPoints{Vec2f{}};
 
         ImGui::Text("Enter X and Y coordinates");
         if(ImGui::BeginListBox("##listNewPoints", ImVec2(-FLT_MIN, ImGui::GetContentRegionAvail().y * 0.8f)))
@@ -246,7 +305,7 @@ void ImGuiAddObjectPopup(const char* str_id)
 
             ImGui::SameLine();
             if(ImGui::Button(" + "))
-                newObjPoints.emplace_back(Point{});
+                newObjPoints.emplace_back(Vec2f{});
 
             ImGui::EndListBox();
         }
@@ -257,24 +316,24 @@ void ImGuiAddObjectPopup(const char* str_id)
         {
             if(newObjPoints.size() == 1)
             {
-                g_World.objects.emplace_back(std::make_unique<Point>(newObjPoints[0]));
+                g_World.add(Point{newObjPoints[0]});
             }
             else if(newObjPoints.size() == 2)
             {
                 LineSegment line;
                 line.p0 = newObjPoints[0];
                 line.p1 = newObjPoints[1];
-                g_World.objects.emplace_back(std::make_unique<LineSegment>(line));
+                g_World.add(line);
             }
             else if(newObjPoints.size() > 2)
             {
-                g_World.objects.emplace_back(std::make_unique<Polygon>(std::move(newObjPoints)));
+                g_World.add(Polygon{std::move(newObjPoints)});
             }
             else
                 g_Logger.AddLog("Not possible to add object with 0 points\n");
 
             newObjPoints.clear();
-            newObjPoints.emplace_back(Point{});
+            newObjPoints.emplace_back(Vec2f{});
         }
 
         ImGui::SameLine();
@@ -282,7 +341,7 @@ void ImGuiAddObjectPopup(const char* str_id)
         if(ImGui::Button("Cancel"))
         {
             newObjPoints.clear();
-            newObjPoints.emplace_back(Point{});
+            newObjPoints.emplace_back(Vec2f{});
             ImGui::CloseCurrentPopup();
         }
         ImGui::EndPopup();
@@ -298,56 +357,70 @@ void ImGuiListAndEditObjects()
 
         ImGuiAddObjectPopup("Add Object");
 
-        static int selectedIdx = -1;
-
         if(ImGui::BeginListBox("##selectObj", ImVec2(-FLT_MIN, ImGui::GetContentRegionAvail().y * 0.5f)))
         {
-            for(int i = 0; i < (int)g_World.objects.size(); ++i)
-            {
-                bool isSelected = (selectedIdx == i);
+            std::optional<ObjectHandle> objToRemove; // Removed after listing, so that the list doesn't change midway
+
+            ImGuiListClipper clipper;
+            clipper.Begin((int) g_World.size());
 
-                if(ImGui::Selectable((g_World.objects[i]->getTypeName() + std::to_string(i)).c_str(), isSelected, ImGuiSelectableFlags_AllowItemOverlap))
+            while(clipper.Step())
+            {
+                for(int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
                 {
-                    if(isSelected) // Clicking on the same object twice to deselect
-                    {
-                        selectedIdx = -1;
-                        isSelected = false;
-                    }
-                    else
+                    ObjectRef ref = g_World.getRef(i);
+                    ObjectHandle handle = g_World.getHandle(ref);
+                    bool isSelected = g_World.isSelected(ref);
+
+                    ImGui::PushID(i);
+
+                    // Named after the slot, so that the names don't change when other objects are removed
+                    if(ImGui::Selectable((g_World.getTypeName(ref) + std::to_string(handle.idx)).c_str(), isSelected, ImGuiSelectableFlags_AllowItemOverlap))
                     {
-                        selectedIdx = i;
-                        isSelected = true;
+                        bool wasOnlySelected = isSelected && g_SelectedObjs.size() == 1;
+
+                        if(ImGui::GetIO().KeyCtrl) // Adds to the selection or takes it out
+                        {
+                            if(isSelected)
+                                deselectObject(ref);
+                            else
+                                selectObject(ref);
+                        }
+                        else
+                        {
+                            clearSelection();
+
+                            if(!wasOnlySelected) // Clicking on the same object twice to deselect
+                                selectObject(ref);
+                        }
                     }
-                }
 
-                if(isSelected)
-                    g_World.objects[i]->isSelected = true;
-                else
-                    g_World.objects[i]->isSelected = false;
+                    ImGui::SameLine();
 
-                ImGui::SameLine();
+                    if(ImGuiAlignedButton(ButtonType::Small, "delete", 1.f))
+                        objToRemove = handle;
 
-                ImGui::PushID(i);
-                if(ImGuiAlignedButton(ButtonType::Small, "delete", 1.f))
-                {
-                    g_World.objects.erase(g_World.objects.begin() + i); // Moves one pos back the elements after the erased one
-                    //std::erase(g_World.objects, g_World.objects[i]); // Possibly more expensive due to comparisons
+                    ImGui::PopID();
                 }
-                ImGui::PopID();
             }
             ImGui::EndListBox();
+
+            if(objToRemove)
+            {
+                g_World.remove(*objToRemove); // The rest of the selection is kept, as handles are not affected by removals
+                std::erase(g_SelectedObjs, *objToRemove);
+            }
         }
 
         ImGui::Separator();
 
-        // Second check for the case when some object was already selected and another file with less objects is loaded
-        if(selectedIdx == -1 || selectedIdx > (int) g_World.objects.size() - 1)
+        if(g_SelectedObjs.empty())
         {
             ImGui::End();
             return;
         }
 
-        ImGuiUIForObjControl(selectedIdx);
+        ImGuiUIForObjControl();
     }
     ImGui::End();
 }
@@ -360,14 +433,12 @@ void ImGuiUIForWindowControl()
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "up", 0.5f, ImGuiDir_Up))
     {
-        g_Window.wmin.y += translationStep;
-        g_Window.wmax.y += translationStep;
+        g_Window.translate({0.f, translationStep});
     }
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "left", 0.25f, ImGuiDir_Left))
     {
-        g_Window.wmin.x -= translationStep;
-        g_Window.wmax.x -= translationStep;
+        g_Window.translate({-translationStep, 0.f});
     }
     
     ImGui::SameLine();
@@ -375,14 +446,12 @@ void ImGuiUIForWindowControl()
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "right", 0.75f, ImGuiDir_Right))
     {
-        g_Window.wmin.x += translationStep;
-        g_Window.wmax.x += translationStep;
+        g_Window.translate({translationStep, 0.f});
     }
 
     if(ImGuiAlignedButton(ButtonType::Arrow, "down", 0.5f, ImGuiDir_Down))
     {
-        g_Window.wmin.y -= translationStep;
-        g_Window.wmax.y -= translationStep;
+        g_Window.translate({0.f, -translationStep});
     }
 
     ImGuiStyle& style = ImGui::GetStyle();
@@ -406,20 +475,101 @@ void ImGuiUIForWindowControl()
         scaleWindow(1.f + scaleFactorStep);
 
     if(ImGui::Button("Reset Window", ImVec2{-FLT_MIN, 0.f}))
-    {
-        /*
-          I realized it's not possible to reset the window (all the time) in the
-          way I'm doing it now, translations with rotations are not commutative.
-          One option is to store the initial pos of each point, maybe not so elegant
-        */
         resetWindow();
+}
+
+/*
+    Clicking on the viewport selects the nearest object within a few pixels of the cursor, and dragging selects the
+    objects lying entirely within the rectangle. Holding Ctrl adds to the selection, or takes the clicked object out of
+    it. Both go through the spatial index of the world, so they stay quick no matter how many objects there are.
+    Must come after updating the viewport coordinates
+*/
+void ImGuiViewportSelection(const DrawTarget& drawTarget)
+{
+    constexpr float pickTolerance = 5.f; // In pixels
+
+    ImVec2 canvasSize = ImGui::GetContentRegionAvail();
+
+    if(canvasSize.x <= 0.f || canvasSize.y <= 0.f)
+        return;
+
+    // Takes the mouse input, otherwise dragging on the viewport would move the window around
+    ImGui::SetCursorScreenPos(drawTarget.currentDrawPos);
+    ImGui::InvisibleButton("##viewportCanvas", canvasSize);
+
+    static Vec2f dragStart;
+
+    ImGuiIO& io = ImGui::GetIO();
+    Vec2f mousePos = Vec2f(io.MousePos) - Vec2f(drawTarget.currentDrawPos);
+
+    if(ImGui::IsItemActivated())
+        dragStart = mousePos;
+
+    Vec2f dragDelta = mousePos - dragStart;
+    bool isDragging = dragDelta.x * dragDelta.x + dragDelta.y * dragDelta.y > io.MouseDragThreshold * io.MouseDragThreshold;
+
+    Bounds rect{{std::min(dragStart.x, mousePos.x), std::min(dragStart.y, mousePos.y)},
+                {std::max(dragStart.x, mousePos.x), std::max(dragStart.y, mousePos.y)}};
+
+    if(ImGui::IsItemActive() && isDragging)
+    {
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+
+        draw_list->AddRectFilled(rect.min + drawTarget.currentDrawPos, rect.max + drawTarget.currentDrawPos, IM_COL32(255, 255, 255, 30));
+        draw_list->AddRect(rect.min + drawTarget.currentDrawPos, rect.max + drawTarget.currentDrawPos, IM_COL32_WHITE, 0.f, ImDrawFlags_None, 1.f);
     }
+
+    if(!ImGui::IsItemDeactivated())
+        return;
+
+    if(isDragging)
+    {
+        if(!io.KeyCtrl)
+            clearSelection();
+
+        ObjectsInRegion found;
+        g_World.findObjectsInRect(g_Window, g_Viewport, rect, found);
+
+        for(auto i : found.points)
+            selectObject({ObjectType::Point, i});
+
+        for(auto i : found.lines)
+            selectObject({ObjectType::LineSegment, i});
+
+        for(auto i : found.polygons)
+            selectObject({ObjectType::Polygon, i});
+
+        return;
+    }
+
+    auto picked = g_World.pickObject(g_Window, g_Viewport, mousePos, pickTolerance);
+
+    if(picked && io.KeyCtrl && g_World.isSelected(*picked))
+    {
+        deselectObject(*picked);
+        return;
+    }
+
+    if(!io.KeyCtrl) // Clicking on nothing clears the selection
+        clearSelection();
+
+    if(picked)
+        selectObject(*picked);
 }
 
 void ImGuiMainWindow()
 {
     static bool wasFileLoaded = false;
     static float thickness = 1.5f;
+    static ViewportMappingStats mappingStats;
+    static LineClippingStats lineClippingStats;
+    static size_t clippedObjects{};
+    static DrawListCache drawListCache;
+    static DrawListStats drawListStats;
+    static bool shouldExportImage{};
+    static int exportScale = 1;
+    static bool exportAsPNG{};
+    static char exportName[64] = "viewport";
     
     uint32_t color{};
 
@@ -432,6 +582,8 @@ void ImGuiMainWindow()
 
     ImGui::Begin("Panel", nullptr, ImGuiWindowFlags_NoTitleBar); ImGui::End();
 
+    g_ImageExportJob.poll(); // Logs the export that was running, once it's done
+
     g_Logger.Draw("Log");
 
     if(!wasFileLoaded)
@@ -441,6 +593,7 @@ void ImGuiMainWindow()
 
     static bool enableLiangBarsky{};
     static bool enableCohenSutherland{};
+    static bool enableCyrusBeck{};
     static bool enableWeilerAtherton{};
 
     ImGui::Begin("Panel", nullptr, ImGuiWindowFlags_NoTitleBar);
@@ -485,23 +638,96 @@ void ImGuiMainWindow()
         ImGui::Text("Line Clipping");
 
         if(ImGui::ToggleButton("Cohen", &enableCohenSutherland))
-            enableLiangBarsky = false;
+            enableLiangBarsky = enableCyrusBeck = false;
 
         ImGui::SameLine();
         ImGui::Text("Cohen Sutherland");
 
+        if(enableCohenSutherland)
+        {
+            ImGui::Text("Accepted: %zu | Rejected: %zu | Clipped: %zu", lineClippingStats.trivialAccepts,
+                        lineClippingStats.trivialRejects, lineClippingStats.clipped);
+            ImGui::SameLine();
+            ImGuiHelpMarker("Segments on the last time they were clipped. Only the ones neither trivially accepted\n"
+                            "nor trivially rejected by their outcodes go through the clipping");
+        }
+
         if(ImGui::ToggleButton("Liang", &enableLiangBarsky))
-            enableCohenSutherland = false;
+            enableCohenSutherland = enableCyrusBeck = false;
 
         ImGui::SameLine();
         ImGui::Text("Liang Barsky");
 
+        if(ImGui::ToggleButton("Cyrus", &enableCyrusBeck))
+            enableCohenSutherland = enableLiangBarsky = false;
+
+        ImGui::SameLine();
+        ImGui::Text("Cyrus Beck");
+        ImGui::SameLine();
+        ImGuiHelpMarker("Clips against the window as a convex polygon, where it is in the world,\n"
+                        "so the segments don't have to be taken to window coordinates first");
+
         ImGui::Text("\nPolygon Clipping");
 
         ImGui::ToggleButton("Weiler", &enableWeilerAtherton);
 
         ImGui::SameLine();
         ImGui::Text("Weiler Atherton");
+
+        ImGui::Separator();
+
+        ImGui::Text("Objects mapped to the viewport: %zu%s", mappingStats.recomputedObjects, mappingStats.wasFullRecompute ? " (all visible)" : "");
+        ImGui::SameLine();
+        ImGuiHelpMarker("On the last frame. All the visible ones are mapped when the window or the viewport change,\n"
+                        "otherwise only the ones that were edited");
+
+        ImGui::Text("Objects clipped: %zu", clippedObjects);
+        ImGui::SameLine();
+        ImGuiHelpMarker("On the last frame. All the visible ones are clipped when the window or the clipping algorithms\n"
+                        "change, otherwise only the ones that were edited");
+
+        ImGui::Text("Objects tessellated: %zu%s", drawListStats.tessellatedObjects, drawListStats.wasRebuilt ? " (all visible)" : "");
+        ImGui::SameLine();
+        ImGuiHelpMarker("On the last frame. The geometry of the rest was copied from the previous frames,\n"
+                        "only the selected and the edited ones are drawn again, until there are too many of them");
+
+        ImGui::ToggleButton("OnDemand", &g_RedrawTracker.isOnDemand);
+        ImGui::SameLine();
+        ImGui::Text("Draw on demand (frames drawn: %llu)", (unsigned long long) g_RedrawTracker.getDrawnFrames());
+        ImGui::SameLine();
+        ImGuiHelpMarker("Frames are only drawn on input, or when the objects, the window or the viewport change,\n"
+                        "otherwise the application waits, leaving the CPU idle");
+
+        ImGui::Separator();
+
+        ImGui::Text("Export Image");
+        ImGui::SameLine();
+        ImGuiHelpMarker("Renders the viewport on the CPU, scale times larger than it's shown,\n"
+                        "with the same colors, thickness and clipping");
+
+        ImGui::SliderInt("Scale", &exportScale, 1, 20, "%d", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::InputText("File name", exportName, sizeof(exportName));
+
+        if(ImGui::RadioButton("PPM", !exportAsPNG))
+            exportAsPNG = false;
+
+#ifdef MIRRAS_PNG_EXPORT
+        ImGui::SameLine();
+        if(ImGui::RadioButton("PNG", exportAsPNG))
+            exportAsPNG = true;
+#endif
+
+        ImGui::BeginDisabled(g_ImageExportJob.isRunning());
+
+        if(ImGui::Button(g_ImageExportJob.isRunning() ? "Exporting..." : "Export"))
+        {
+            if(exportName[0] == '\0')
+                g_Logger.AddLog("Empty file name, unable to export\n");
+            else
+                shouldExportImage = true;
+        }
+
+        ImGui::EndDisabled();
     }
     ImGui::End();
 
@@ -518,35 +744,48 @@ void ImGuiMainWindow()
         ImDrawList* draw_list = ImGui::GetWindowDrawList();
         ImVec2 currentDrawPos = ImGui::GetCursorScreenPos();
 
-        DrawTarget drawTarget{.draw_list = draw_list,
+        ImGuiDrawBackend backend{draw_list};
+
+        DrawTarget drawTarget{.backend = &backend,
+                              .window = &g_Window,
+                              .viewport = &g_Viewport,
                               .currentDrawPos = currentDrawPos,
                               .thickness = thickness,
-                              .enableCohenSutherland = enableCohenSutherland,
-                              .enableLiangBarsky = enableLiangBarsky,
-                              .enableWeilerAtherton = enableWeilerAtherton};
+                              .clipping = {.enableCohenSutherland = enableCohenSutherland,
+                                           .enableLiangBarsky = enableLiangBarsky,
+                                           .enableCyrusBeck = enableCyrusBeck,
+                                           .enableWeilerAtherton = enableWeilerAtherton}};
 
         if(ImGui::IsWindowDocked())
         {
             auto[totalW, totalH] = ImGui::GetContentRegionAvail();
-            g_Viewport.width  = totalW - 2 * g_Viewport.borderW;
-            g_Viewport.height = totalH - 2 * g_Viewport.borderH;
+            g_Viewport.setSize(totalW - 2 * g_Viewport.borderW, totalH - 2 * g_Viewport.borderH);
         }
         else
-        {
-            g_Viewport.width  = totalWidth - 2 * g_Viewport.borderW;
-            g_Viewport.height = totalHeight - 2 * g_Viewport.borderH;
-        }
+            g_Viewport.setSize(totalWidth - 2 * g_Viewport.borderW, totalHeight - 2 * g_Viewport.borderH);
 
-        Vec2f vmin = {g_Viewport.borderW, g_Viewport.borderH};
-        Vec2f vmax = {g_Viewport.width, g_Viewport.height};
-        objectsToViewportCoord(g_World.objects, g_Window.wmin, g_Window.wmax, vmin, vmax);
+        findVisibleObjects(g_World, g_Window, g_Viewport, drawTarget);
+        mappingStats = objectsToViewportCoord(g_World, g_Window, g_Viewport);
+        clippedObjects = clipObjects(g_World, g_Window, g_Viewport, drawTarget.clipping, &lineClippingStats);
         
-        drawObjects(g_World.objects, drawTarget);
+        drawListStats = drawObjects(g_World, drawTarget, drawListCache);
 
         // Draw viewport borders
         Vec2f borderMin = {g_Viewport.borderW, g_Viewport.borderH};
         Vec2f borderMax = {g_Viewport.width + g_Viewport.borderW, g_Viewport.height + g_Viewport.borderH};
         draw_list->AddRect(borderMin + currentDrawPos, borderMax + currentDrawPos, IM_COL32_WHITE, 1.f, ImDrawFlags_None, 0.5f);
+
+        // Recorded on this thread, as the world can't be read from elsewhere, rasterized and written in the background
+        if(shouldExportImage)
+        {
+            auto background = ImGui::GetColorU32(ImGuiCol_WindowBg) | IM_COL32_A_MASK;
+            auto path = std::string{exportName} + (exportAsPNG ? ".png" : ".ppm");
+
+            g_ImageExportJob.start(recordViewport(g_World, drawTarget), getExportOptions(g_Viewport, exportScale, background), std::move(path));
+            shouldExportImage = false;
+        }
+
+        ImGuiViewportSelection(drawTarget);
     }
     ImGui::End();
     ImGui::PopStyleVar();
@@ -6,10 +6,11 @@
 #include <imfilebrowser.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
-#include <glm/glm.hpp>
 
 #include "utils.h"
 #include "representation.h"
+#include "drawListCache.h"
+#include "drawBackend.h"
 
 // Embedded font
 #include "Fonts/Bahnschrift.embed"
@@ -18,12 +19,13 @@ namespace mirras
 {
 struct DrawTarget
 {
-    ImDrawList* draw_list{};
-    ImVec2 currentDrawPos;
+    DrawBackend* backend{};
+    const Window* window{};     // Those the objects were mapped to the viewport and clipped with
+    const Viewport* viewport{};
+    ImVec2 currentDrawPos{};
     float thickness{};
-    bool enableCohenSutherland{};
-    bool enableLiangBarsky{};
-    bool enableWeilerAtherton{};
+    ClippingOptions clipping; // The clipped geometry must have been updated with the same options
+    DrawListCache* cache{};   // Filled with what is drawn, when set
 };
 
 inline void initGLFW()
@@ -90,21 +92,57 @@ inline void ImGuiNewFrame()
     ImGui::NewFrame();
 }
 
-inline void drawObjects(const std::vector<std::unique_ptr<Object>>& objects, const DrawTarget& drawTarget)
+/*
+    Without clipping, whatever reaches past the viewport is still visible up to the edges of the ImGui window, which
+    is as large as the viewport plus its borders. In viewport coordinates, with room for the thickness of the outlines
+*/
+inline Bounds getDrawArea(const DrawTarget& drawTarget)
 {
-    for(const auto& obj : objects)
-        obj->draw(drawTarget);
+    float margin = drawTarget.thickness + 2.f; // Points reach 2 pixels from their center, plus the thickness
+
+    const auto& vp = *drawTarget.viewport;
+
+    return {{-margin, -margin}, {vp.width + 2 * vp.borderW + margin, vp.height + 2 * vp.borderH + margin}};
 }
 
-inline void objectsToViewportCoord(std::vector<std::unique_ptr<Object>>& objects, Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+// Only the objects that might show up in the draw area are mapped, clipped and drawn, so this comes first
+inline void findVisibleObjects(World& world, const Window& win, const Viewport& vp, const DrawTarget& drawTarget)
 {
-    for(auto& obj : objects)
-        obj->toViewportCoord(wmin, wmax, vmin, vmax);
+    auto viewportToWorld = win.worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height}).inverse();
+
+    world.updateVisibleObjects(transformBounds(getDrawArea(drawTarget), viewportToWorld));
+}
+
+inline void drawObjects(const World& world, const DrawTarget& drawTarget)
+{
+    const auto& visibleObjs = world.getVisibleObjects();
+
+    world.points.draw(drawTarget, visibleObjs.points);
+    world.lines.draw(drawTarget, visibleObjs.lines);
+    world.polygons.draw(drawTarget, visibleObjs.polygons);
+}
+
+// Same as above, but copying from the cache whatever hasn't changed since the last frame
+inline DrawListStats drawObjects(World& world, const DrawTarget& drawTarget, DrawListCache& cache)
+{
+    return cache.draw(world, drawTarget);
+}
+
+// Only the objects whose inputs changed since the last call are mapped again, see World::updateViewportCoord
+inline ViewportMappingStats objectsToViewportCoord(World& world, const Window& win, const Viewport& vp)
+{
+    return world.updateViewportCoord(win, vp);
+}
+
+// Only the objects whose inputs changed since the last call are clipped again, see World::updateClippedGeometry
+inline size_t clipObjects(World& world, const Window& win, const Viewport& vp, const ClippingOptions& options, LineClippingStats* lineStats)
+{
+    return world.updateClippedGeometry(win, vp, options, lineStats);
 }
 
 void ImGuiFileMenu(bool& wasFileLoaded);
 
-void ImGuiUIForObjControl(int objIdx);
+void ImGuiUIForObjControl();
 
 void ImGuiAddObjectPopup(const char* str_id);
 
@@ -112,6 +150,8 @@ void ImGuiListAndEditObjects();
 
 void ImGuiUIForWindowControl();
 
+void ImGuiViewportSelection(const DrawTarget& drawTarget);
+
 void ImGuiMainWindow();
 
 void renderImGui();
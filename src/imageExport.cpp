@@ -0,0 +1,154 @@
+#include "imageExport.h"
+
+#include "graphics.h"
+#include "redrawTracker.h"
+
+#include <chrono>
+#include <cstdio>
+
+namespace mirras
+{
+DrawRecorder recordViewport(const World& world, const DrawTarget& drawTarget)
+{
+    DrawRecorder recorder;
+
+    auto recordTarget = drawTarget;
+    recordTarget.backend = &recorder;
+    recordTarget.currentDrawPos = {};
+    recordTarget.cache = nullptr;
+
+    drawObjects(world, recordTarget);
+
+    const auto& vp = *drawTarget.viewport;
+
+    Vec2f borderMin = {vp.borderW, vp.borderH};
+    Vec2f borderMax = {vp.width + vp.borderW, vp.height + vp.borderH};
+    Vec2f border[] = {borderMin, {borderMax.x, borderMin.y}, borderMax, {borderMin.x, borderMax.y}};
+    recorder.addClosedPolyline(border, IM_COL32_WHITE, 0.5f);
+
+    return recorder;
+}
+
+RasterOptions getExportOptions(const Viewport& vp, int scale, uint32_t background)
+{
+    return {.width = uint32_t((vp.width + 2 * vp.borderW) * scale),
+            .height = uint32_t((vp.height + 2 * vp.borderH) * scale),
+            .scale = float(scale),
+            .background = background};
+}
+
+ImageExportResult rasterizeAndWrite(const DrawRecorder& recording, const RasterOptions& options, std::string path, WorkerPool& pool)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto image = rasterize(recording, options, pool);
+
+    bool isPNG = path.ends_with(".png");
+    bool wasWritten = isPNG ? writePNG(image, path.c_str()) : writePPM(image, path.c_str());
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return {std::move(path), image.width, image.height, elapsed.count(), wasWritten};
+}
+
+void ImageExportJob::start(DrawRecorder recording, const RasterOptions& options, std::string path)
+{
+    if(isRunning())
+        return;
+
+    g_Logger.AddLog("Exporting the viewport to %s...\n", path.c_str());
+
+    thread = std::jthread{[this, recording = std::move(recording), options, path = std::move(path)]
+    {
+        WorkerPool pool;
+        result = rasterizeAndWrite(recording, options, path, pool);
+
+        isDone = true;
+        g_RedrawTracker.requestRedraw();
+    }};
+}
+
+void ImageExportJob::poll()
+{
+    if(!isRunning() || !isDone)
+        return;
+
+    thread.join();
+    isDone = false;
+
+    if(result.wasWritten)
+        g_Logger.AddLog("Done! %ux%u image written to %s in %.2f s\n", result.width, result.height, result.path.c_str(), result.seconds);
+    else
+        g_Logger.AddLog("Failed to write %s\n", result.path.c_str());
+}
+
+void ImageExportJob::wait()
+{
+    if(isRunning())
+        thread.join();
+
+    isDone = false;
+}
+
+// The application draws the viewport over its windows, which use ImGui's dark colors, made opaque
+static uint32_t getWindowBackground()
+{
+    ImGuiStyle style;
+    ImGui::StyleColorsDark(&style);
+
+    auto color = style.Colors[ImGuiCol_WindowBg];
+    color.w = 1.f;
+
+    return ImGui::ColorConvertFloat4ToU32(color);
+}
+
+int exportSceneImage(const char* scenePath, const char* imagePath, int scale)
+{
+    if(scale < 1)
+    {
+        std::fprintf(stderr, "The scale must be a positive integer\n");
+        return 1;
+    }
+
+    auto data = loadDataFromXMLFile(scenePath);
+
+    if(!data)
+    {
+        std::fprintf(stderr, "Not able to load %s\n", scenePath);
+        return 1;
+    }
+
+    // Otherwise set from the panel of the application, these are its defaults
+    Point::color = ImColor(ImVec4{0.f, 1.f, 0.9f, 1.f});
+    LineSegment::color = ImColor(ImVec4{0.9f, 1.f, 0.f, 1.f});
+    Polygon::color = ImColor(ImVec4{0.f, 1.f, 0.1f, 1.f});
+
+    auto& world = data->world;
+    const auto& win = data->window;
+    const auto& vp = data->viewport;
+
+    // As in the application with Liang Barsky and Weiler Atherton turned on, at the default thickness
+    DrawTarget drawTarget{.window = &win,
+                          .viewport = &vp,
+                          .thickness = 1.5f,
+                          .clipping = {.enableLiangBarsky = true, .enableWeilerAtherton = true}};
+
+    findVisibleObjects(world, win, vp, drawTarget);
+    objectsToViewportCoord(world, win, vp);
+    clipObjects(world, win, vp, drawTarget.clipping, nullptr);
+
+    auto recording = recordViewport(world, drawTarget);
+    auto result = rasterizeAndWrite(recording, getExportOptions(vp, scale, getWindowBackground()), imagePath, g_WorkerPool);
+
+    if(!result.wasWritten)
+    {
+        std::fprintf(stderr, "Failed to write %s\n", result.path.c_str());
+        return 1;
+    }
+
+    std::printf("%ux%u image written to %s in %.2f s\n", result.width, result.height, result.path.c_str(), result.seconds);
+
+    return 0;
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "drawBackend.h"
+#include "rasterizer.h"
+#include "representation.h"
+#include "workerPool.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace mirras
+{
+struct DrawTarget;
+
+struct ImageExportResult
+{
+    std::string path;
+    uint32_t width{};
+    uint32_t height{};
+    double seconds{};
+    bool wasWritten{};
+};
+
+// Records what the viewport shows, borders included, the same way the objects are drawn on screen. The objects must
+// be ready to be drawn with the target, that is found visible, mapped and clipped with its window and viewport
+DrawRecorder recordViewport(const World& world, const DrawTarget& drawTarget);
+
+// The whole viewport, borders included, scale times larger
+RasterOptions getExportOptions(const Viewport& vp, int scale, uint32_t background);
+
+// Written as PNG when the path ends with .png, as PPM otherwise
+ImageExportResult rasterizeAndWrite(const DrawRecorder& recording, const RasterOptions& options, std::string path, WorkerPool& pool);
+
+/*
+    Rasterizes and writes an exported image on a thread of its own, so that a large export doesn't hold the UI.
+    g_WorkerPool only takes batches from the UI thread, so the tiles are filled on a pool that belongs to the job.
+    The job keeps its own recording, the world can be edited meanwhile. Once done, it asks for a redraw, and the
+    next frame logs how it went from the UI thread, as the logger isn't safe to use from other threads
+*/
+class ImageExportJob
+{
+public:
+    // Does nothing while another export is running
+    void start(DrawRecorder recording, const RasterOptions& options, std::string path);
+
+    // Until the job is done and its result was logged by poll
+    bool isRunning() const { return thread.joinable(); }
+
+    // Called every frame from the UI thread
+    void poll();
+
+    // Blocks until the running export, if any, is written
+    void wait();
+
+private:
+    std::jthread thread;
+    std::atomic<bool> isDone{};
+    ImageExportResult result; // Only read once isDone is set
+};
+
+inline ImageExportJob g_ImageExportJob;
+
+// Loads a scene file and writes the image of its viewport, without a window nor an OpenGL context.
+// Returns the exit code of the application
+int exportSceneImage(const char* scenePath, const char* imagePath, int scale);
+
+} // namespace mirras
\ No newline at end of file
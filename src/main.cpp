@@ -1,7 +1,27 @@
 #include "application.h"
+#include "benchmark.h"
+#include "imageExport.h"
 
-int main()
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+int main(int argc, char* argv[])
 {
+    if(argc > 1 && std::string_view{argv[1]} == "--benchmark")
+        return mirras::runBenchmarks();
+
+    if(argc > 1 && std::string_view{argv[1]} == "--export")
+    {
+        if(argc < 4)
+        {
+            std::fprintf(stderr, "Usage: %s --export <scene.xml> <image.png|image.ppm> [scale]\n", argv[0]);
+            return 1;
+        }
+
+        return mirras::exportSceneImage(argv[2], argv[3], argc > 4 ? std::atoi(argv[4]) : 1);
+    }
+
     mirras::App app{800, 600, "CG-Project"};
     app.run();
 }
@@ -2,203 +2,1204 @@
 
 #include "graphics.h"
 #include "clippingAlgorithms.h"
+#include "workerPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
 
 //#include <iostream>
 
 namespace mirras
 {
-///////////////  Point  /////////////////
-void Point::draw(const DrawTarget& target) const
+// Erases the marked elements in one pass, keeping the order of the remaining ones
+template<typename T>
+static void eraseMarked(std::pmr::vector<T>& elements, std::span<const uint8_t> marked)
 {
-    Vec2f vP = {vX, vY};
-    uint32_t tempColor = isSelected ? IM_COL32_WHITE : color;
+    size_t count{};
+
+    for(size_t i = 0; i < elements.size(); ++i)
+    {
+        if(!marked[i])
+            elements[count++] = elements[i];
+    }
 
-    // Workaround to draw a point
-    target.draw_list->AddCircle(vP + target.currentDrawPos, 2.f, tempColor, 0, target.thickness);
+    elements.resize(count);
+}
+
+// Moves the last element into idx
+template<typename T>
+static void swapAndPop(std::pmr::vector<T>& elements, uint32_t idx)
+{
+    elements[idx] = elements.back();
+    elements.pop_back();
 }
 
-void Point::toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+///////////////  Vertex  /////////////////
+Bounds transformBounds(const Bounds& box, const Affine2D& transform)
 {
-    toViewport(wmin, wmax, vmin, vmax);
+    Vec2f corners[] = {transform.apply(box.min), transform.apply(box.max),
+                       transform.apply({box.min.x, box.max.y}), transform.apply({box.max.x, box.min.y})};
+
+    Bounds newBox{corners[0], corners[0]};
+
+    for(const auto& c : corners)
+    {
+        newBox.min = {std::min(newBox.min.x, c.x), std::min(newBox.min.y, c.y)};
+        newBox.max = {std::max(newBox.max.x, c.x), std::max(newBox.max.y, c.y)};
+    }
+
+    return newBox;
 }
 
-void Point::toViewport(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+Overlap classifyBounds(const Bounds& box, const Bounds& region)
 {
-    vX = (x - wmin.x) / (wmax.x - wmin.x) * (vmax.x) + vmin.x;
-    vY = (1 - (y - wmin.y) / (wmax.y - wmin.y)) * (vmax.y) + vmin.y;
+    if(box.max.x < region.min.x || box.min.x > region.max.x || box.max.y < region.min.y || box.min.y > region.max.y)
+        return Overlap::Outside;
+
+    if(box.min.x >= region.min.x && box.max.x <= region.max.x && box.min.y >= region.min.y && box.max.y <= region.max.y)
+        return Overlap::Inside;
+
+    return Overlap::Partial;
 }
 
-void Point::writeViewportCoordToFile(std::ofstream& outputFile) const
+static Bounds segmentBounds(Vec2f p0, Vec2f p1)
 {
-    outputFile << "Point:    " << vX << "   " << vY << '\n';
+    return {{std::min(p0.x, p1.x), std::min(p0.y, p1.y)}, {std::max(p0.x, p1.x), std::max(p0.y, p1.y)}};
 }
 
-void Point::applyTransform(const glm::mat4& transform)
+// Distance from a point to the closest point of a segment
+static float distanceToSegment(Vec2f p, Vec2f a, Vec2f b)
 {
-    auto result = transform * glm::vec4(x, y, 0.f, 1.f);
-    x = result.x;
-    y = result.y;
+    Vec2f ab = b - a;
+    Vec2f ap = p - a;
+
+    float lengthSq = ab.x * ab.x + ab.y * ab.y;
+    float t = lengthSq > 0.f ? std::clamp((ap.x * ab.x + ap.y * ab.y) / lengthSq, 0.f, 1.f) : 0.f;
+
+    Vec2f d = ap - ab * t;
+
+    return std::sqrt(d.x * d.x + d.y * d.y);
 }
 
-Vec2f Point::getCenter() const
+static bool isInsideRect(Vec2f p, const Bounds& rect)
 {
-    return {x, y};
+    return p.x >= rect.min.x && p.x <= rect.max.x && p.y >= rect.min.y && p.y <= rect.max.y;
 }
 
-bool Point::isInside(const Window& win) const
+bool isVertexInside(Vec2f p, const Window& win)
 {
-    if(x <= win.wmax.x && x >= win.wmin.x && y <= win.wmax.y && y >= win.wmin.y)
+    p = win.toWindowCoord(p);
+
+    if(p.x <= win.wmax.x && p.x >= win.wmin.x && p.y <= win.wmax.y && p.y >= win.wmin.y)
         return true;
 
     return false;
 }
 
-///////////////  Line Segment  /////////////////
-void LineSegment::draw(const DrawTarget& target) const
+/*
+    Convex when every turn goes the same way and the edges go around only once, which rules out self intersecting
+    shapes like a star (the direction of the edges along x can only change twice in a single loop)
+*/
+PolygonShape classifyPolygon(std::span<const Vec2f> vertices)
 {
-    uint32_t tempColor = isSelected ? IM_COL32_WHITE : color;
+    if(vertices.empty())
+        return {};
 
-    Vec2f vmin = {g_Viewport.borderW, g_Viewport.borderH};
-    Vec2f vmax = {g_Viewport.width, g_Viewport.height};
+    PolygonShape shape{.bounds = {vertices[0], vertices[0]}};
 
-    std::optional<LineSeg> line;
+    float signedArea{};
+    int turnSign{};
+    int directionChanges{};
+    bool isConvex = true;
 
-    if(target.enableCohenSutherland)
-        line = cohenSutherland(g_Window, LineSeg{p0, p1});
-    else
-    if(target.enableLiangBarsky)
-        line = liangBarsky(g_Window, LineSeg{p0, p1});
-    else
+    float prevDirX{};
+
+    for(size_t i = 0; i < vertices.size(); ++i)
     {
-        Vec2f vP0 = {p0.vX, p0.vY};
-        Vec2f vP1 = {p1.vX, p1.vY};
+        Vec2f p0 = vertices[i];
+        Vec2f p1 = vertices[(i + 1) % vertices.size()];
+        Vec2f p2 = vertices[(i + 2) % vertices.size()];
 
-        target.draw_list->AddLine(vP0 + target.currentDrawPos, vP1 + target.currentDrawPos, tempColor, target.thickness);
+        shape.bounds.min = {std::min(shape.bounds.min.x, p0.x), std::min(shape.bounds.min.y, p0.y)};
+        shape.bounds.max = {std::max(shape.bounds.max.x, p0.x), std::max(shape.bounds.max.y, p0.y)};
+
+        signedArea += p0.x * p1.y - p1.x * p0.y;
+
+        float cross = (p1.x - p0.x) * (p2.y - p1.y) - (p1.y - p0.y) * (p2.x - p1.x);
+
+        if(cross != 0.f)
+        {
+            int sign = cross > 0.f ? 1 : -1;
+
+            if(turnSign != 0 && sign != turnSign)
+                isConvex = false;
+
+            turnSign = sign;
+        }
 
+        float dirX = p1.x - p0.x;
+
+        if(dirX != 0.f)
+        {
+            if(prevDirX != 0.f && (dirX > 0.f) != (prevDirX > 0.f))
+                ++directionChanges;
+
+            prevDirX = dirX;
+        }
+    }
+
+    // The first edge along x also has to be compared with the last one
+    for(size_t i = 0; i < vertices.size(); ++i)
+    {
+        float dirX = vertices[(i + 1) % vertices.size()].x - vertices[i].x;
+
+        if(dirX != 0.f)
+        {
+            if((dirX > 0.f) != (prevDirX > 0.f))
+                ++directionChanges;
+
+            break;
+        }
+    }
+
+    shape.isConvex = isConvex && directionChanges <= 2 && vertices.size() >= 3;
+    shape.isClockwise = signedArea < 0.f;
+
+    return shape;
+}
+
+///////////////  Point Array  /////////////////
+void PointArray::add(const Point& point, uint32_t slot)
+{
+    if(!vPositions.empty())
+        vPositions.emplace_back();
+
+    positions.push_back(point.pos);
+    isSelected.push_back(false);
+    slots.push_back(slot);
+    versions.push_back(0);
+}
+
+void PointArray::remove(uint32_t idx)
+{
+    if(hasViewportCoord())
+        swapAndPop(vPositions, idx);
+
+    swapAndPop(positions, idx);
+    swapAndPop(isSelected, idx);
+    swapAndPop(slots, idx);
+    swapAndPop(versions, idx);
+}
+
+void PointArray::removeMarked(std::span<const uint8_t> marked)
+{
+    if(hasViewportCoord())
+        eraseMarked(vPositions, marked);
+
+    eraseMarked(positions, marked);
+    eraseMarked(isSelected, marked);
+    eraseMarked(slots, marked);
+    eraseMarked(versions, marked);
+}
+
+void PointArray::reserve(size_t count)
+{
+    positions.reserve(count);
+    isSelected.reserve(count);
+    slots.reserve(count);
+    versions.reserve(count);
+}
+
+void PointArray::draw(const DrawTarget& target, std::span<const uint32_t> idxs) const
+{
+    assert(hasViewportCoord());
+
+    auto drawArea = getDrawArea(target);
+
+    // Handed to the backend all at once, unless the cache has to tell the points apart
+    std::vector<Vec2f> centers;
+    std::vector<uint32_t> colors;
+
+    if(!target.cache)
+    {
+        centers.reserve(idxs.size());
+        colors.reserve(idxs.size());
+    }
+
+    for(auto i : idxs)
+    {
+        if(classifyBounds({vPositions[i], vPositions[i]}, drawArea) == Overlap::Outside)
+            continue;
+
+        uint32_t tempColor = isSelected[i] ? IM_COL32_WHITE : Point::color;
+
+        if(target.cache)
+        {
+            target.backend->addPoint(vPositions[i] + target.currentDrawPos, 2.f, tempColor, target.thickness);
+            target.cache->captureObject({ObjectType::Point, i});
+        }
+        else
+        {
+            centers.push_back(vPositions[i] + target.currentDrawPos);
+            colors.push_back(tempColor);
+        }
+    }
+
+    target.backend->addPoints(centers, colors, 2.f, target.thickness);
+}
+
+void PointArray::toViewportCoord(const Affine2D& transform)
+{
+    vPositions.resize(positions.size());
+
+    transformVertices(positions, vPositions, transform);
+}
+
+void PointArray::toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs)
+{
+    // All of them, the batched kernel runs through them faster
+    if(idxs.size() == size())
+    {
+        toViewportCoord(transform);
         return;
     }
 
-    if(line)
+    vPositions.resize(positions.size());
+
+    for(auto i : idxs)
+        vPositions[i] = transform.apply(positions[i]);
+}
+
+void PointArray::toViewportCoord(uint32_t idx, const Affine2D& transform)
+{
+    vPositions.resize(positions.size());
+    vPositions[idx] = transform.apply(positions[idx]);
+}
+
+// Every point, mapped here, as only the visible ones are kept up to date in viewport coordinates
+void PointArray::writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const
+{
+    for(const auto& p : positions)
+    {
+        Vec2f vP = worldToViewport.apply(p);
+        outputFile << "Point:    " << vP.x << "   " << vP.y << '\n';
+    }
+}
+
+void PointArray::applyTransform(uint32_t idx, const Affine2D& transform)
+{
+    positions[idx] = transform.apply(positions[idx]);
+    ++versions[idx];
+}
+
+void PointArray::applyTransform(const Affine2D& transform)
+{
+    applyTransform(transform, 0, (uint32_t) size());
+}
+
+void PointArray::applyTransform(const Affine2D& transform, uint32_t first, uint32_t last)
+{
+    transform.apply(std::span{positions}.subspan(first, last - first));
+
+    for(uint32_t i = first; i < last; ++i)
+        ++versions[i];
+}
+
+Vec2f PointArray::getCenter(uint32_t idx) const
+{
+    return positions[idx];
+}
+
+bool PointArray::isInside(uint32_t idx, const Window& win) const
+{
+    return isVertexInside(positions[idx], win);
+}
+
+float PointArray::getViewportDistance(uint32_t idx, Vec2f p) const
+{
+    return distanceToSegment(p, vPositions[idx], vPositions[idx]);
+}
+
+bool PointArray::isViewportInside(uint32_t idx, const Bounds& rect) const
+{
+    return isInsideRect(vPositions[idx], rect);
+}
+
+///////////////  Line Segment Array  /////////////////
+void LineSegmentArray::add(const LineSegment& line, uint32_t slot)
+{
+    if(!vP0.empty())
+    {
+        vP0.emplace_back();
+        vP1.emplace_back();
+    }
+
+    if(!clippedStamps.empty())
     {
-        Point p0{line->p0.x, line->p0.y};
-        Point p1{line->p1.x, line->p1.y};
+        clippedP0.emplace_back();
+        clippedP1.emplace_back();
+        vClippedP0.emplace_back();
+        vClippedP1.emplace_back();
+        isClippedVisible.push_back(false);
+        clippedStamps.push_back(0); // Never up to date, as the epoch starts from 1
+    }
 
-        p0.toViewport(g_Window.wmin, g_Window.wmax, vmin, vmax);
-        p1.toViewport(g_Window.wmin, g_Window.wmax, vmin, vmax);
+    p0.push_back(line.p0);
+    p1.push_back(line.p1);
+    bounds.push_back(segmentBounds(line.p0, line.p1));
+    isSelected.push_back(false);
+    slots.push_back(slot);
+    versions.push_back(0);
+}
 
-        Vec2f vP0 = {p0.vX, p0.vY};
-        Vec2f vP1 = {p1.vX, p1.vY};
+void LineSegmentArray::remove(uint32_t idx)
+{
+    if(hasViewportCoord())
+    {
+        swapAndPop(vP0, idx);
+        swapAndPop(vP1, idx);
+    }
 
-        target.draw_list->AddLine(vP0 + target.currentDrawPos, vP1 + target.currentDrawPos, tempColor, target.thickness);        
+    if(hasClippedGeometry())
+    {
+        swapAndPop(clippedP0, idx);
+        swapAndPop(clippedP1, idx);
+        swapAndPop(vClippedP0, idx);
+        swapAndPop(vClippedP1, idx);
+        swapAndPop(isClippedVisible, idx);
+        swapAndPop(clippedStamps, idx);
     }
+
+    swapAndPop(p0, idx);
+    swapAndPop(p1, idx);
+    swapAndPop(bounds, idx);
+    swapAndPop(isSelected, idx);
+    swapAndPop(slots, idx);
+    swapAndPop(versions, idx);
 }
 
-void LineSegment::toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+void LineSegmentArray::removeMarked(std::span<const uint8_t> marked)
 {
-    p0.toViewport(wmin, wmax, vmin, vmax);
-    p1.toViewport(wmin, wmax, vmin, vmax);
+    if(hasViewportCoord())
+    {
+        eraseMarked(vP0, marked);
+        eraseMarked(vP1, marked);
+    }
+
+    if(hasClippedGeometry())
+    {
+        eraseMarked(clippedP0, marked);
+        eraseMarked(clippedP1, marked);
+        eraseMarked(vClippedP0, marked);
+        eraseMarked(vClippedP1, marked);
+        eraseMarked(isClippedVisible, marked);
+        eraseMarked(clippedStamps, marked);
+    }
+
+    eraseMarked(p0, marked);
+    eraseMarked(p1, marked);
+    eraseMarked(bounds, marked);
+    eraseMarked(isSelected, marked);
+    eraseMarked(slots, marked);
+    eraseMarked(versions, marked);
 }
 
-void LineSegment::writeViewportCoordToFile(std::ofstream& outputFile) const
+void LineSegmentArray::reserve(size_t count)
 {
-    outputFile << "Line:\n          " << p0.vX << "   " << p0.vY << '\n';
-    outputFile <<        "          " << p1.vX << "   " << p1.vY << '\n';
+    p0.reserve(count);
+    p1.reserve(count);
+    bounds.reserve(count);
+    isSelected.reserve(count);
+    slots.reserve(count);
+    versions.reserve(count);
 }
 
-void LineSegment::applyTransform(const glm::mat4& transform)
+void LineSegmentArray::draw(const DrawTarget& target, std::span<const uint32_t> idxs) const
 {
-    p0.applyTransform(transform);
-    p1.applyTransform(transform);
+    assert(hasViewportCoord());
+
+    if(!target.clipping.isLineClippingEnabled())
+    {
+        auto drawArea = getDrawArea(target);
+
+        for(auto i : idxs)
+        {
+            if(classifyBounds(segmentBounds(vP0[i], vP1[i]), drawArea) == Overlap::Outside)
+                continue;
+
+            uint32_t tempColor = isSelected[i] ? IM_COL32_WHITE : LineSegment::color;
+
+            target.backend->addLine(vP0[i] + target.currentDrawPos, vP1[i] + target.currentDrawPos, tempColor, target.thickness);
+
+            if(target.cache)
+                target.cache->captureObject({ObjectType::LineSegment, i});
+        }
+
+        return;
+    }
+
+    assert(hasClippedGeometry() && clippedOptions == target.clipping);
+
+    for(auto i : idxs)
+    {
+        if(!isClippedVisible[i])
+            continue;
+
+        uint32_t tempColor = isSelected[i] ? IM_COL32_WHITE : LineSegment::color;
+
+        target.backend->addLine(vClippedP0[i] + target.currentDrawPos, vClippedP1[i] + target.currentDrawPos, tempColor, target.thickness);
+
+        if(target.cache)
+            target.cache->captureObject({ObjectType::LineSegment, i});
+    }
 }
 
-Vec2f LineSegment::getCenter() const
+/*
+    Only the given segments edited since they were last clipped go through the clipping again, unless the window or
+    the algorithm changed. They are gathered so that the batched kernels still run over contiguous arrays.
+    A resized viewport only needs the clipped endpoints to be mapped again. Returns how many segments were clipped
+*/
+size_t LineSegmentArray::updateClippedGeometry(const Window& win, const Viewport& vp, const ClippingOptions& options,
+                                               std::span<const uint32_t> idxs, LineClippingStats* stats)
 {
-    return (p0 + p1) / 2.f;
+    if(!options.isLineClippingEnabled())
+        return 0;
+
+    bool clipAll = !hasClippedGeometry() || win.version != clippedWindowVersion || options != clippedOptions;
+
+    if(clipAll)
+    {
+        clippedP0.resize(size());
+        clippedP1.resize(size());
+        vClippedP0.resize(size());
+        vClippedP1.resize(size());
+        isClippedVisible.resize(size());
+        clippedStamps.resize(size());
+        ++clipEpoch; // Every result is out of date at once, without going through them
+    }
+
+    // Clipping happens in window coordinates, so only the window to viewport mapping is left afterwards.
+    // Cyrus Beck clips in world coordinates instead, against the window where it is in the world
+    auto vpTransform = options.enableCyrusBeck ? win.worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height})
+                                               : windowToViewport(win.wmin, win.wmax, {vp.borderW, vp.borderH}, {vp.width, vp.height});
+    bool mapAll = clipAll || vp.version != clippedViewportVersion;
+
+    clippedWindowVersion = win.version;
+    clippedViewportVersion = vp.version;
+    clippedOptions = options;
+
+    std::vector<uint32_t> staleIdxs;
+
+    for(auto i : idxs)
+    {
+        if(clippedStamps[i] != getClipStamp(i))
+            staleIdxs.push_back(i);
+    }
+
+    if(!staleIdxs.empty())
+    {
+        std::vector<Vec2f> staleP0(staleIdxs.size()), staleP1(staleIdxs.size());
+        std::vector<uint8_t> isVisible(staleIdxs.size());
+
+        for(size_t k = 0; k < staleIdxs.size(); ++k)
+        {
+            staleP0[k] = p0[staleIdxs[k]];
+            staleP1[k] = p1[staleIdxs[k]];
+        }
+
+        if(options.enableCyrusBeck)
+            cyrusBeck(ConvexRegion{win.getWorldCorners()}, staleP0, staleP1, staleP0, staleP1, isVisible);
+        else
+        {
+            transformVertices(staleP0, staleP0, win.view);
+            transformVertices(staleP1, staleP1, win.view);
+
+            if(options.enableCohenSutherland)
+            {
+                auto clippingStats = cohenSutherland(win, staleP0, staleP1, staleP0, staleP1, isVisible);
+
+                if(stats)
+                    *stats = clippingStats;
+            }
+            else
+                liangBarsky(win, staleP0, staleP1, staleP0, staleP1, isVisible);
+        }
+
+        for(size_t k = 0; k < staleIdxs.size(); ++k)
+        {
+            uint32_t i = staleIdxs[k];
+
+            clippedP0[i] = staleP0[k];
+            clippedP1[i] = staleP1[k];
+            isClippedVisible[i] = isVisible[k];
+            clippedStamps[i] = getClipStamp(i);
+
+            if(!mapAll)
+            {
+                vClippedP0[i] = vpTransform.apply(staleP0[k]);
+                vClippedP1[i] = vpTransform.apply(staleP1[k]);
+            }
+        }
+    }
+
+    if(mapAll && idxs.size() == size())
+    {
+        transformVertices(clippedP0, vClippedP0, vpTransform);
+        transformVertices(clippedP1, vClippedP1, vpTransform);
+    }
+    else if(mapAll)
+    {
+        for(auto i : idxs)
+        {
+            vClippedP0[i] = vpTransform.apply(clippedP0[i]);
+            vClippedP1[i] = vpTransform.apply(clippedP1[i]);
+        }
+    }
+
+    return staleIdxs.size();
 }
 
-bool LineSegment::isInside(const Window& win) const
+void LineSegmentArray::toViewportCoord(const Affine2D& transform)
 {
-    if(p0.isInside(win) && p1.isInside(win))
-        return true;
+    vP0.resize(p0.size());
+    vP1.resize(p1.size());
 
-    return false;
+    transformVertices(p0, vP0, transform);
+    transformVertices(p1, vP1, transform);
 }
 
-///////////////  Polygon  /////////////////
-void Polygon::draw(const DrawTarget& target) const
+void LineSegmentArray::toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs)
 {
-    std::vector<ImVec2> pointsWithOffset;
-    pointsWithOffset.reserve(vertices.size());
+    // All of them, the batched kernel runs through them faster
+    if(idxs.size() == size())
+    {
+        toViewportCoord(transform);
+        return;
+    }
 
-    uint32_t tempColor = isSelected ? IM_COL32_WHITE : color;
-    bool isInsideWindow{};
+    vP0.resize(p0.size());
+    vP1.resize(p1.size());
 
-    if(isInside(g_Window))
-        isInsideWindow = true;
+    for(auto i : idxs)
+    {
+        vP0[i] = transform.apply(p0[i]);
+        vP1[i] = transform.apply(p1[i]);
+    }
+}
+
+void LineSegmentArray::toViewportCoord(uint32_t idx, const Affine2D& transform)
+{
+    vP0.resize(p0.size());
+    vP1.resize(p1.size());
+
+    vP0[idx] = transform.apply(p0[idx]);
+    vP1[idx] = transform.apply(p1[idx]);
+}
 
-    if(!target.enableWeilerAtherton || isInsideWindow)
+// Every segment, unclipped, see PointArray::writeViewportCoordToFile
+void LineSegmentArray::writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const
+{
+    for(size_t i = 0; i < size(); ++i)
     {
-        for(const auto& p : vertices)
-            pointsWithOffset.emplace_back(Vec2f{p.vX, p.vY} + target.currentDrawPos);
+        Vec2f vP0 = worldToViewport.apply(p0[i]);
+        Vec2f vP1 = worldToViewport.apply(p1[i]);
+
+        outputFile << "Line:\n          " << vP0.x << "   " << vP0.y << '\n';
+        outputFile <<        "          " << vP1.x << "   " << vP1.y << '\n';
+    }
+}
+
+void LineSegmentArray::applyTransform(uint32_t idx, const Affine2D& transform)
+{
+    p0[idx] = transform.apply(p0[idx]);
+    p1[idx] = transform.apply(p1[idx]);
+    bounds[idx] = segmentBounds(p0[idx], p1[idx]);
+    ++versions[idx];
+}
 
-        target.draw_list->AddPolyline(pointsWithOffset.data(), vertices.size(), tempColor, ImDrawFlags_Closed, target.thickness);
+void LineSegmentArray::applyTransform(const Affine2D& transform)
+{
+    applyTransform(transform, 0, (uint32_t) size());
+}
+
+void LineSegmentArray::applyTransform(const Affine2D& transform, uint32_t first, uint32_t last)
+{
+    transform.apply(std::span{p0}.subspan(first, last - first));
+    transform.apply(std::span{p1}.subspan(first, last - first));
+
+    for(uint32_t i = first; i < last; ++i)
+    {
+        bounds[i] = segmentBounds(p0[i], p1[i]);
+        ++versions[i];
     }
+}
+
+Vec2f LineSegmentArray::getCenter(uint32_t idx) const
+{
+    return (p0[idx] + p1[idx]) / 2.f;
+}
+
+bool LineSegmentArray::isInside(uint32_t idx, const Window& win) const
+{
+    switch(win.classify(bounds[idx]))
+    {
+    case Overlap::Inside:  return true;
+    case Overlap::Outside: return false;
+    default:               return isVertexInside(p0[idx], win) && isVertexInside(p1[idx], win);
+    }
+}
+
+float LineSegmentArray::getViewportDistance(uint32_t idx, Vec2f p) const
+{
+    return distanceToSegment(p, vP0[idx], vP1[idx]);
+}
+
+bool LineSegmentArray::isViewportInside(uint32_t idx, const Bounds& rect) const
+{
+    return isInsideRect(vP0[idx], rect) && isInsideRect(vP1[idx], rect);
+}
+
+///////////////  Polygon Array  /////////////////
+// Taken up in the pool of clipped vertices by the sub polygons of a polygon
+static size_t getClippedVertexCount(const PolygonArray& polygons, uint32_t idx)
+{
+    if(!polygons.isInClippedPool(idx))
+        return 0;
+
+    size_t count{};
+    auto[firstSubPoly, subPolyCount] = polygons.clippedPolygons[idx];
+
+    for(uint32_t j = firstSubPoly; j < firstSubPoly + subPolyCount; ++j)
+        count += polygons.clippedSubPolygons[j].count;
+
+    return count;
+}
+
+void PolygonArray::add(std::span<const Vec2f> polyVertices, uint32_t slot)
+{
+    if(!vVertices.empty())
+        vVertices.resize(vVertices.size() + polyVertices.size());
+
+    if(!clippedStamps.empty())
+    {
+        clippedPolygons.emplace_back();
+        clippedStamps.push_back(0); // Never up to date, as the epoch starts from 1
+    }
+
+    ranges.emplace_back(VertexRange{(uint32_t) vertices.size(), (uint32_t) polyVertices.size()});
+    vertices.insert(vertices.end(), polyVertices.begin(), polyVertices.end());
+    transforms.emplace_back();
+    shapes.push_back(classifyPolygon(polyVertices));
+    bounds.push_back(shapes.back().bounds);
+    isSelected.push_back(false);
+    slots.push_back(slot);
+    versions.push_back(0);
+}
+
+void PolygonArray::remove(uint32_t idx)
+{
+    unusedVertexCount += ranges[idx].count;
+
+    if(hasClippedGeometry())
+    {
+        unusedClippedVertexCount += getClippedVertexCount(*this, idx);
+
+        swapAndPop(clippedPolygons, idx);
+        swapAndPop(clippedStamps, idx);
+    }
+
+    swapAndPop(ranges, idx);
+    swapAndPop(transforms, idx);
+    swapAndPop(shapes, idx);
+    swapAndPop(bounds, idx);
+    swapAndPop(isSelected, idx);
+    swapAndPop(slots, idx);
+    swapAndPop(versions, idx);
+
+    // Only pay for moving the vertices once most of the pool is wasted
+    if(unusedVertexCount > vertices.size() / 2)
+        compactVertices();
+}
+
+void PolygonArray::removeMarked(std::span<const uint8_t> marked)
+{
+    if(hasClippedGeometry())
+    {
+        for(uint32_t i = 0; i < size(); ++i)
+        {
+            if(marked[i])
+                unusedClippedVertexCount += getClippedVertexCount(*this, i);
+        }
+
+        eraseMarked(clippedPolygons, marked);
+        eraseMarked(clippedStamps, marked);
+    }
+
+    eraseMarked(ranges, marked);
+    eraseMarked(transforms, marked);
+    eraseMarked(shapes, marked);
+    eraseMarked(bounds, marked);
+    eraseMarked(isSelected, marked);
+    eraseMarked(slots, marked);
+    eraseMarked(versions, marked);
+
+    compactVertices();
+}
+
+// Polygons that were removed, or moved into the place of removed ones, leave the ranges out of order in their pool.
+// Gives the indices of the ranges in the order they are laid out in, so that they can be moved down one after the other
+template<typename GetFirst>
+static std::vector<uint32_t> sortByFirst(std::vector<uint32_t> idxs, GetFirst&& getFirst)
+{
+    if(!std::ranges::is_sorted(idxs, {}, getFirst))
+        std::ranges::sort(idxs, {}, getFirst);
+
+    return idxs;
+}
+
+// Moves the vertices still in use down to the start of the pool, in place, keeping their order
+void PolygonArray::compactVertices()
+{
+    bool compactViewportCoord = hasViewportCoord();
+
+    std::vector<uint32_t> idxs(size());
+    std::iota(idxs.begin(), idxs.end(), 0);
+    idxs = sortByFirst(std::move(idxs), [&](uint32_t i) { return ranges[i].first; });
+
+    uint32_t next{};
+
+    // Each range only moves towards the start, never over a range that hasn't been moved yet
+    for(auto i : idxs)
+    {
+        auto& range = ranges[i];
+
+        std::copy_n(vertices.begin() + range.first, range.count, vertices.begin() + next);
+
+        if(compactViewportCoord)
+            std::copy_n(vVertices.begin() + range.first, range.count, vVertices.begin() + next);
+
+        range.first = next;
+        next += range.count;
+    }
+
+    vertices.resize(next);
+
+    if(compactViewportCoord)
+        vVertices.resize(next);
     else
+        vVertices.clear();
+
+    unusedVertexCount = 0;
+}
+
+// Moves the sub polygons still in use, and both coordinates of their vertices, down to the start of their pools, in place
+void PolygonArray::compactClippedVertices()
+{
+    std::vector<uint32_t> idxs;
+
+    for(uint32_t i = 0; i < size(); ++i)
+    {
+        if(isInClippedPool(i))
+            idxs.push_back(i);
+        else
+            clippedPolygons[i] = {};
+    }
+
+    // The vertices of the sub polygons are laid out in the same order as the sub polygons themselves
+    idxs = sortByFirst(std::move(idxs), [&](uint32_t i) { return clippedPolygons[i].first; });
+
+    uint32_t nextSubPoly{};
+    uint32_t nextVertex{};
+
+    for(auto i : idxs)
+    {
+        auto[firstSubPoly, subPolyCount] = clippedPolygons[i];
+        clippedPolygons[i].first = nextSubPoly;
+
+        for(uint32_t j = firstSubPoly; j < firstSubPoly + subPolyCount; ++j)
+        {
+            auto[first, count] = clippedSubPolygons[j];
+
+            std::copy_n(clippedVertices.begin() + first, count, clippedVertices.begin() + nextVertex);
+            std::copy_n(vClippedVertices.begin() + first, count, vClippedVertices.begin() + nextVertex);
+
+            clippedSubPolygons[nextSubPoly++] = {nextVertex, count};
+            nextVertex += count;
+        }
+    }
+
+    clippedVertices.resize(nextVertex);
+    vClippedVertices.resize(nextVertex);
+    clippedSubPolygons.resize(nextSubPoly);
+    unusedClippedVertexCount = 0;
+}
+
+void PolygonArray::reserve(size_t count, size_t vertexCount)
+{
+    vertices.reserve(vertexCount);
+    ranges.reserve(count);
+    transforms.reserve(count);
+    shapes.reserve(count);
+    bounds.reserve(count);
+    isSelected.reserve(count);
+    slots.reserve(count);
+    versions.reserve(count);
+}
+
+void PolygonArray::draw(const DrawTarget& target, std::span<const uint32_t> idxs) const
+{
+    assert(hasViewportCoord());
+
+    std::vector<Vec2f> pointsWithOffset;
+
+    auto addPolyline = [&](std::span<const Vec2f> vpVertices, uint32_t color)
     {
-        auto subPolygons = weilerAtherton(*this, g_Window);
+        pointsWithOffset.clear();
+
+        for(const auto& vP : vpVertices)
+            pointsWithOffset.emplace_back(vP + target.currentDrawPos);
 
-        Vec2f vmin = {g_Viewport.borderW, g_Viewport.borderH};
-        Vec2f vmax = {g_Viewport.width, g_Viewport.height};
+        target.backend->addClosedPolyline(pointsWithOffset, color, target.thickness);
+    };
+
+    if(!target.clipping.enableWeilerAtherton)
+    {
+        auto drawArea = getDrawArea(target);
+        const auto& vp = *target.viewport;
+        auto worldToViewport = target.window->worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height});
 
-        for(const auto& subPoly : subPolygons)
+        for(auto i : idxs)
         {
-            pointsWithOffset.clear();
+            if(classifyBounds(transformBounds(bounds[i], worldToViewport), drawArea) == Overlap::Outside)
+                continue;
+
+            addPolyline(getViewportVertices(i), isSelected[i] ? IM_COL32_WHITE : Polygon::color);
+
+            if(target.cache)
+                target.cache->captureObject({ObjectType::Polygon, i});
+        }
+
+        return;
+    }
+
+    assert(hasClippedGeometry() && clippedOptions == target.clipping);
+
+    for(auto i : idxs)
+    {
+        uint32_t tempColor = isSelected[i] ? IM_COL32_WHITE : Polygon::color;
+
+        auto[firstSubPoly, subPolyCount] = clippedPolygons[i];
+
+        for(uint32_t j = firstSubPoly; j < firstSubPoly + subPolyCount; ++j)
+        {
+            auto[first, count] = clippedSubPolygons[j];
+            addPolyline(std::span{vClippedVertices}.subspan(first, count), tempColor);
+        }
+
+        if(target.cache)
+            target.cache->captureObject({ObjectType::Polygon, i});
+    }
+}
 
-            for(const auto& vert : subPoly)
+// Buffers reused from one polygon to the next while clipping them
+struct PolygonClipBuffers
+{
+    std::vector<Vec2f> windowVertices, clipped, scratch;
+};
+
+// Passes each part of a polygon within the window, in window coordinates, to addSubPolygon
+template<typename AddSubPolygon>
+static void clipPolygon(const PolygonArray& polygons, uint32_t idx, const Window& win, PolygonClipBuffers& buffers, AddSubPolygon&& addSubPolygon)
+{
+    auto overlap = win.classify(polygons.bounds[idx]);
+
+    if(overlap == Overlap::Outside)
+        return;
+
+    polygons.getWorldVertices(idx, buffers.windowVertices, win.view);
+
+    if(overlap == Overlap::Inside)
+        addSubPolygon(buffers.windowVertices);
+    else if(polygons.shapes[idx].isConvex)
+    {
+        sutherlandHodgman(buffers.windowVertices, win, buffers.clipped, buffers.scratch);
+
+        if(buffers.clipped.size() >= 3)
+            addSubPolygon(buffers.clipped);
+    }
+    else
+    {
+        for(const auto& subPoly : weilerAtherton(buffers.windowVertices, win))
+            addSubPolygon(subPoly);
+    }
+}
+
+/*
+    Clips the given polygons edited since they were last clipped, or all of them if the window or the algorithm
+    changed. Most polygons are settled by their bounds alone, the convex ones always come out as a single polygon,
+    which Sutherland Hodgman finds in linear time, and the rest go through Weiler Atherton.
+    A resized viewport only needs the clipped vertices to be mapped again. Returns how many polygons were clipped
+*/
+// Below this, splitting the clipping costs more than it saves, most polygons are only copied
+static constexpr size_t minPolygonsPerClipChunk = 64;
+
+/*
+    The polygons to clip again are split into chunks, clipped at the same time on the worker pool. Each chunk writes
+    its sub polygons, and their viewport coordinates, to its own buffers, which are then appended to the pool in the
+    order of the chunks, so it ends up the same as if the polygons had been clipped one after the other.
+    When there is a single chunk (few polygons, or no workers), they are clipped one after the other, into the pool
+*/
+size_t PolygonArray::updateClippedGeometry(const Window& win, const Viewport& vp, const ClippingOptions& options, std::span<const uint32_t> idxs, WorkerPool& pool)
+{
+    if(!options.enableWeilerAtherton)
+        return 0;
+
+    bool clipAll = !hasClippedGeometry() || win.version != clippedWindowVersion || options != clippedOptions;
+
+    if(clipAll)
+    {
+        clippedPolygons.resize(size());
+        clippedStamps.resize(size());
+        clippedVertices.clear();
+        vClippedVertices.clear();
+        clippedSubPolygons.clear();
+        unusedClippedVertexCount = 0;
+        ++clipEpoch; // Every result is out of date at once, without going through them
+    }
+
+    // Clipping happens in window coordinates, so only the window to viewport mapping is left afterwards
+    auto vpTransform = windowToViewport(win.wmin, win.wmax, {vp.borderW, vp.borderH}, {vp.width, vp.height});
+    bool mapAll = clipAll || vp.version != clippedViewportVersion;
+
+    clippedWindowVersion = win.version;
+    clippedViewportVersion = vp.version;
+    clippedOptions = options;
+
+    // The ones still up to date only have to be mapped again, each one to its own part of the pool
+    if(mapAll)
+    {
+        pool.parallelFor(idxs.size(), minPolygonsPerClipChunk, [&](size_t first, size_t last)
+        {
+            for(size_t k = first; k < last; ++k)
+            {
+                uint32_t i = idxs[k];
+
+                if(clippedStamps[i] != getClipStamp(i))
+                    continue;
+
+                auto[firstSubPoly, subPolyCount] = clippedPolygons[i];
+
+                for(uint32_t j = firstSubPoly; j < firstSubPoly + subPolyCount; ++j)
+                {
+                    auto[firstVertex, vertexCount] = clippedSubPolygons[j];
+                    transformVertices(std::span{clippedVertices}.subspan(firstVertex, vertexCount),
+                                      std::span{vClippedVertices}.subspan(firstVertex, vertexCount), vpTransform);
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> staleIdxs;
+
+    for(auto i : idxs)
+    {
+        if(clippedStamps[i] != getClipStamp(i))
+            staleIdxs.push_back(i);
+    }
+
+    size_t chunkCount = pool.getChunkCount(staleIdxs.size(), minPolygonsPerClipChunk);
+
+    // Nothing to split, the polygons are clipped straight into the end of the pool, without going through chunk buffers
+    if(chunkCount <= 1)
+    {
+        size_t firstNewVertex = clippedVertices.size();
+        PolygonClipBuffers buffers;
+
+        for(auto i : staleIdxs)
+        {
+            unusedClippedVertexCount += getClippedVertexCount(*this, i);
+            clippedStamps[i] = getClipStamp(i);
+            auto firstSubPoly = (uint32_t) clippedSubPolygons.size();
+
+            clipPolygon(*this, i, win, buffers, [&](std::span<const Vec2f> subPoly)
+            {
+                clippedSubPolygons.push_back({(uint32_t) clippedVertices.size(), (uint32_t) subPoly.size()});
+                clippedVertices.insert(clippedVertices.end(), subPoly.begin(), subPoly.end());
+            });
+
+            clippedPolygons[i] = {firstSubPoly, uint32_t(clippedSubPolygons.size() - firstSubPoly)};
+        }
+
+        vClippedVertices.resize(clippedVertices.size());
+        transformVertices(std::span{clippedVertices}.subspan(firstNewVertex), std::span{vClippedVertices}.subspan(firstNewVertex), vpTransform);
+    }
+    else
+    {
+        struct ClippedChunk
+        {
+            std::vector<Vec2f> vertices;  // Window Coordinates
+            std::vector<Vec2f> vVertices; // Viewport Coordinates
+            std::vector<VertexRange> subPolygons; // Within the vertices of the chunk
+            std::vector<uint32_t> subPolyCounts;  // Of each polygon of the chunk
+        };
+
+        std::vector<ClippedChunk> chunks(chunkCount);
+
+        pool.parallelForChunks(staleIdxs.size(), minPolygonsPerClipChunk, [&](size_t chunk, size_t first, size_t last)
+        {
+            auto& out = chunks[chunk];
+            PolygonClipBuffers buffers;
+
+            for(size_t k = first; k < last; ++k)
             {
-                Point p{vert.pos.x, vert.pos.y};
-                p.toViewport(g_Window.wmin, g_Window.wmax, vmin, vmax);
+                size_t subPolyCount = out.subPolygons.size();
 
-                pointsWithOffset.emplace_back(Vec2f{p.vX, p.vY} + target.currentDrawPos);
+                clipPolygon(*this, staleIdxs[k], win, buffers, [&](std::span<const Vec2f> subPoly)
+                {
+                    out.subPolygons.push_back({(uint32_t) out.vertices.size(), (uint32_t) subPoly.size()});
+                    out.vertices.insert(out.vertices.end(), subPoly.begin(), subPoly.end());
+                });
+
+                out.subPolyCounts.push_back(uint32_t(out.subPolygons.size() - subPolyCount));
+            }
+
+            out.vVertices.resize(out.vertices.size());
+            transformVertices(out.vertices, out.vVertices, vpTransform);
+        });
+
+        // The new sub polygons go to the end of the pool, the old ones are left unused
+        size_t k{};
+
+        for(const auto& chunk : chunks)
+        {
+            auto vertexOffset = (uint32_t) clippedVertices.size();
+            size_t subPolyIdx{};
+
+            clippedVertices.insert(clippedVertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+            vClippedVertices.insert(vClippedVertices.end(), chunk.vVertices.begin(), chunk.vVertices.end());
+
+            for(auto subPolyCount : chunk.subPolyCounts)
+            {
+                uint32_t i = staleIdxs[k++];
+
+                unusedClippedVertexCount += getClippedVertexCount(*this, i);
+                clippedStamps[i] = getClipStamp(i);
+                clippedPolygons[i] = {(uint32_t) clippedSubPolygons.size(), subPolyCount};
+
+                for(uint32_t j = 0; j < subPolyCount; ++j)
+                {
+                    auto[first, count] = chunk.subPolygons[subPolyIdx++];
+                    clippedSubPolygons.push_back({first + vertexOffset, count});
+                }
             }
-            target.draw_list->AddPolyline(pointsWithOffset.data(), pointsWithOffset.size(), tempColor, ImDrawFlags_Closed, target.thickness);
+        }
+    }
+
+    // Only pay for moving the clipped vertices once most of the pool is wasted
+    if(unusedClippedVertexCount > clippedVertices.size() / 2)
+        compactClippedVertices();
+
+    return staleIdxs.size();
+}
+
+void PolygonArray::toViewportCoord(const Affine2D& transform)
+{
+    vVertices.resize(vertices.size());
+
+    for(uint32_t i = 0; i < size(); ++i)
+        toViewportCoord(i, transform);
+}
+
+void PolygonArray::toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs)
+{
+    vVertices.resize(vertices.size());
+
+    for(auto i : idxs)
+        toViewportCoord(i, transform);
+}
+
+// Straight from the original geometry, the transform of the polygon is folded into the mapping
+void PolygonArray::toViewportCoord(uint32_t idx, const Affine2D& transform)
+{
+    vVertices.resize(vertices.size());
+
+    auto[first, count] = ranges[idx];
+    transformVertices(std::span{vertices}.subspan(first, count), std::span{vVertices}.subspan(first, count), transform * transforms[idx]);
+}
+
+// Every polygon, unclipped, see PointArray::writeViewportCoordToFile
+void PolygonArray::writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const
+{
+    for(uint32_t i = 0; i < size(); ++i)
+    {
+        auto transform = worldToViewport * transforms[i];
+
+        outputFile << "Polygon:\n";
+        for(const auto& p : getVertices(i))
+        {
+            Vec2f vP = transform.apply(p);
+            outputFile << "          " << vP.x << "   " << vP.y << '\n';
         }
     }
 }
 
-void Polygon::toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+void PolygonArray::applyTransform(uint32_t idx, const Affine2D& transform)
 {
-    for(auto& p : vertices)
-        p.toViewport(wmin, wmax, vmin, vmax);
+    transforms[idx] = transform * transforms[idx];
+    bounds[idx] = transformBounds(shapes[idx].bounds, transforms[idx]);
+    ++versions[idx];
 }
 
-void Polygon::writeViewportCoordToFile(std::ofstream& outputFile) const
+void PolygonArray::applyTransform(const Affine2D& transform)
 {
-    outputFile << "Polygon:\n";
-    for(const auto& p : vertices)
-        outputFile << "          " << p.vX << "   " << p.vY << '\n';
+    applyTransform(transform, 0, (uint32_t) size());
 }
 
-void Polygon::applyTransform(const glm::mat4& transform)
+void PolygonArray::applyTransform(const Affine2D& transform, uint32_t first, uint32_t last)
 {
-    for(auto& p : vertices)
-        p.applyTransform(transform);
+    for(uint32_t i = first; i < last; ++i)
+    {
+        transforms[i] = transform * transforms[i];
+        bounds[i] = transformBounds(shapes[i].bounds, transforms[i]);
+        ++versions[i];
+    }
 }
 
-Vec2f Polygon::getCenter() const
+// Affine transforms keep the centroid, so there's no need to transform every vertex
+Vec2f PolygonArray::getCenter(uint32_t idx) const
 {
+    auto polyVertices = getVertices(idx);
+
+    // A file may hold a polygon without vertices, it's left where its transform puts the origin
+    if(polyVertices.empty())
+        return transforms[idx].apply(Vec2f{});
+
     Vec2f sum{};
-    for(const auto& p : vertices)
+    for(const auto& p : polyVertices)
         sum = sum + p;
 
-    return sum / (float) vertices.size();
+    return transforms[idx].apply(sum / (float) polyVertices.size());
+}
+
+void PolygonArray::getWorldVertices(uint32_t idx, std::vector<Vec2f>& out, const Affine2D& view) const
+{
+    auto polyVertices = getVertices(idx);
+
+    out.resize(polyVertices.size());
+    transformVertices(polyVertices, out, view * transforms[idx]);
 }
 
-bool Polygon::isInside(const Window& win) const
+bool PolygonArray::isInside(uint32_t idx, const Window& win) const
 {
-    for(const auto& p : vertices)
+    auto overlap = win.classify(bounds[idx]);
+
+    if(overlap != Overlap::Partial)
+        return overlap == Overlap::Inside;
+
+    for(const auto& p : getVertices(idx))
     {
-        if(p.isInside(win))
+        if(isVertexInside(transforms[idx].apply(p), win))
             continue;
         else
             return false;
@@ -207,4 +1208,30 @@ bool Polygon::isInside(const Window& win) const
     return true;
 }
 
+// Only the outline is drawn, so that's what is measured, a point inside a polygon is still far from it
+float PolygonArray::getViewportDistance(uint32_t idx, Vec2f p) const
+{
+    auto polyVertices = getViewportVertices(idx);
+
+    // Nothing is drawn of a polygon without vertices, so it's never picked
+    if(polyVertices.empty())
+        return FLT_MAX;
+
+    float distance = distanceToSegment(p, polyVertices.back(), polyVertices.front());
+
+    for(size_t i = 1; i < polyVertices.size(); ++i)
+        distance = std::min(distance, distanceToSegment(p, polyVertices[i - 1], polyVertices[i]));
+
+    return distance;
+}
+
+// The rectangle is convex, so the polygon lies within it when all of its vertices do
+bool PolygonArray::isViewportInside(uint32_t idx, const Bounds& rect) const
+{
+    auto polyVertices = getViewportVertices(idx);
+
+    // A polygon without vertices isn't selected by a rectangle either
+    return !polyVertices.empty() && std::ranges::all_of(polyVertices, [&](Vec2f p) { return isInsideRect(p, rect); });
+}
+
 } // namespace mirras
\ No newline at end of file
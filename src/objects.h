@@ -1,96 +1,279 @@
 #pragma once
 
 #include "vec2f.h"
+#include "viewportTransform.h"
 
 #include <vector>
+#include <span>
+#include <memory_resource>
 #include <fstream>
 
-#include <glm/mat4x4.hpp>
-
 namespace mirras
 {
 struct DrawTarget;
+struct LineClippingStats;
 class Window;
+class Viewport;
+class WorkerPool;
+
+// Plain records used to build objects before they are added to the World.
+// The vertices are stored as Vec2f, the viewport coordinates only live in the World arrays
 
-struct Object
+struct Point
 {
-    virtual void draw(const DrawTarget& drawTarget) const = 0;
-    virtual void toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax) = 0;
-    virtual void writeViewportCoordToFile(std::ofstream& outputFile) const = 0;
-    virtual void applyTransform(const glm::mat4& transform) = 0;
-    virtual Vec2f getCenter() const = 0;
-    virtual const char* getTypeName() const = 0;
-    virtual bool isInside(const Window& win) const = 0;
+    Vec2f pos{};
+    static inline uint32_t color{};
+};
 
-    bool isSelected{};
+struct LineSegment
+{
+    Vec2f p0{}, p1{};
+    static inline uint32_t color{};
+};
 
-    virtual ~Object() = default;
+struct Polygon
+{
+    std::vector<Vec2f> vertices;
+    static inline uint32_t color{};
 };
 
-struct Point : public Object
+bool isVertexInside(Vec2f p, const Window& win);
+
+// Axis aligned bounding box
+struct Bounds
 {
-    Point() = default;
-    Point(float _x, float _y) : x(_x), y(_y) {}
+    Vec2f min{}, max{};
 
-    virtual void draw(const DrawTarget& drawTarget) const override;
-    virtual void toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax) override;
-    virtual void writeViewportCoordToFile(std::ofstream& outputFile) const override;
-    virtual void applyTransform(const glm::mat4& transform) override;
-    virtual Vec2f getCenter() const override;
-    virtual bool isInside(const Window& win) const override;
+    friend bool operator== (const Bounds&, const Bounds&) = default;
+};
 
-    virtual const char* getTypeName() const
-    {
-        return "Point";
-    }
+// Bounds of a box after the transform. Exact unless it rotates the box, then they contain it
+Bounds transformBounds(const Bounds& box, const Affine2D& transform);
 
-    void toViewport(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax);
+enum class Overlap : uint8_t
+{
+    Outside,
+    Inside,
+    Partial
+};
 
-    // Implicitly converts Point to Vec2f
-    operator Vec2f() const{ return Vec2f{x, y}; }
+// Where a box lies relative to a region, both in the same coordinates
+Overlap classifyBounds(const Bounds& box, const Bounds& region);
 
-    float x{}, y{};   // World Coordinates
-    float vX{}, vY{}; // Viewport Coordinates
-    static inline uint32_t color{};
+// Which clipping algorithms are enabled. The clipped geometry is cached for a given combination of them
+struct ClippingOptions
+{
+    bool enableCohenSutherland{};
+    bool enableLiangBarsky{};
+    bool enableCyrusBeck{}; // Against the window where it is in the world, so the segments don't go to window coordinates
+    bool enableWeilerAtherton{};
+
+    bool isLineClippingEnabled() const { return enableCohenSutherland || enableLiangBarsky || enableCyrusBeck; }
+
+    friend bool operator== (const ClippingOptions&, const ClippingOptions&) = default;
 };
 
-struct LineSegment : public Object
+/*
+    Type partitioned storage used by the World. Each kind of object lives in its own set of contiguous arrays,
+    which are iterated linearly every frame, so there is no per object allocation nor virtual dispatch involved.
+    Viewport coordinates are kept in separate buffers, which are only allocated once the objects are mapped
+    to the viewport, so code that only deals with world coordinates (loading, saving, transforming) never touches them.
+    Once allocated, they are kept the same size as the world coordinates, new objects get a placeholder until mapped.
+    Each object also has a version, incremented every time its geometry changes.
+    The per frame work (mapping, clipping, drawing) takes the indices of the objects to go through, in increasing
+    order, which the World finds with its spatial index, so that objects far from the window aren't even visited.
+    All the arrays allocate from the memory resource of the scene they belong to (see SceneArena).
+    Removing an object moves the last one of the same type into its place, so the World is told which slot
+    of its slot map refers to each object, in order to keep the handles up to date.
+*/
+
+struct PointArray
 {
-    virtual void draw(const DrawTarget& drawTarget) const override;
-    virtual void toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax) override;
-    virtual void writeViewportCoordToFile(std::ofstream& outputFile) const override;
-    virtual void applyTransform(const glm::mat4& transform) override;
-    virtual Vec2f getCenter() const override;
-    virtual bool isInside(const Window& win) const override;
-
-    virtual const char* getTypeName() const
-    {
-        return "Line";
-    }
+    explicit PointArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : positions(resource), vPositions(resource), isSelected(resource), slots(resource), versions(resource) {}
 
-    Point p0{}, p1{};
-    static inline uint32_t color{};
+    void add(const Point& point, uint32_t slot);
+    void remove(uint32_t idx); // Swap and pop
+    void removeMarked(std::span<const uint8_t> marked);
+    void reserve(size_t count);
+
+    void draw(const DrawTarget& drawTarget, std::span<const uint32_t> idxs) const;
+    void toViewportCoord(const Affine2D& transform);
+    void toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs);
+    void toViewportCoord(uint32_t idx, const Affine2D& transform);
+    void writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const;
+    void applyTransform(uint32_t idx, const Affine2D& transform);
+    void applyTransform(const Affine2D& transform); // To all points
+    void applyTransform(const Affine2D& transform, uint32_t first, uint32_t last); // To the ones in [first, last)
+    Vec2f getCenter(uint32_t idx) const;
+    bool isInside(uint32_t idx, const Window& win) const;
+    float getViewportDistance(uint32_t idx, Vec2f p) const; // From what's drawn of it, in viewport coordinates
+    bool isViewportInside(uint32_t idx, const Bounds& rect) const;
+
+    size_t size() const { return positions.size(); }
+
+    bool hasViewportCoord() const { return vPositions.size() == positions.size(); }
+
+    std::pmr::vector<Vec2f> positions;  // World Coordinates
+    std::pmr::vector<Vec2f> vPositions; // Viewport Coordinates
+    std::pmr::vector<uint8_t> isSelected;
+    std::pmr::vector<uint32_t> slots;
+    std::pmr::vector<uint32_t> versions;
 };
 
-struct Polygon : public Object
+struct LineSegmentArray
 {
-    Polygon() = default;
-    Polygon(std::vector<Point> _vertices) : vertices(std::move(_vertices)) {}
+    explicit LineSegmentArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : p0(resource), p1(resource), vP0(resource), vP1(resource), bounds(resource), isSelected(resource), slots(resource),
+          versions(resource), clippedP0(resource), clippedP1(resource), vClippedP0(resource), vClippedP1(resource),
+          isClippedVisible(resource), clippedStamps(resource) {}
+
+    void add(const LineSegment& line, uint32_t slot);
+    void remove(uint32_t idx); // Swap and pop
+    void removeMarked(std::span<const uint8_t> marked);
+    void reserve(size_t count);
+
+    void draw(const DrawTarget& drawTarget, std::span<const uint32_t> idxs) const;
+    size_t updateClippedGeometry(const Window& win, const Viewport& vp, const ClippingOptions& options,
+                                 std::span<const uint32_t> idxs, LineClippingStats* stats);
+    void toViewportCoord(const Affine2D& transform);
+    void toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs);
+    void toViewportCoord(uint32_t idx, const Affine2D& transform);
+    void writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const;
+    void applyTransform(uint32_t idx, const Affine2D& transform);
+    void applyTransform(const Affine2D& transform); // To all line segments
+    void applyTransform(const Affine2D& transform, uint32_t first, uint32_t last); // To the ones in [first, last)
+    Vec2f getCenter(uint32_t idx) const;
+    bool isInside(uint32_t idx, const Window& win) const;
+    float getViewportDistance(uint32_t idx, Vec2f p) const; // From what's drawn of it, in viewport coordinates
+    bool isViewportInside(uint32_t idx, const Bounds& rect) const;
 
-    virtual void draw(const DrawTarget& drawTarget) const override;
-    virtual void toViewportCoord(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax) override;
-    virtual void writeViewportCoordToFile(std::ofstream& outputFile) const override;
-    virtual void applyTransform(const glm::mat4& transform) override;
-    virtual Vec2f getCenter() const override;
-    virtual bool isInside(const Window& win) const override;
+    size_t size() const { return p0.size(); }
 
-    virtual const char* getTypeName() const
+    bool hasViewportCoord() const { return vP0.size() == p0.size(); }
+
+    bool hasClippedGeometry() const { return clippedStamps.size() == p0.size(); }
+
+    // The cached result of a segment is up to date when its stamp matches this one
+    uint64_t getClipStamp(uint32_t idx) const { return uint64_t(clipEpoch) << 32 | versions[idx]; }
+
+    std::pmr::vector<Vec2f> p0, p1;   // Endpoints, world Coordinates
+    std::pmr::vector<Vec2f> vP0, vP1; // Endpoints, viewport Coordinates
+    std::pmr::vector<Bounds> bounds;  // World Coordinates, updated along with the endpoints
+    std::pmr::vector<uint8_t> isSelected;
+    std::pmr::vector<uint32_t> slots;
+    std::pmr::vector<uint32_t> versions;
+
+    // Result of the last clipping, kept until the segment, the window or the clipping options change.
+    // Allocated on the first update with clipping enabled, then kept the same size as the endpoints
+    std::pmr::vector<Vec2f> clippedP0, clippedP1;   // Window Coordinates, world Coordinates with Cyrus Beck
+    std::pmr::vector<Vec2f> vClippedP0, vClippedP1; // Viewport Coordinates
+    std::pmr::vector<uint8_t> isClippedVisible;
+    std::pmr::vector<uint64_t> clippedStamps; // Epoch and version of each segment when it was clipped
+    uint32_t clipEpoch{}; // Incremented every time all of them have to be clipped again
+    uint64_t clippedWindowVersion{};
+    uint64_t clippedViewportVersion{};
+    ClippingOptions clippedOptions;
+};
+
+// Range of a polygon within the shared vertex pool
+struct VertexRange
+{
+    uint32_t first{};
+    uint32_t count{};
+};
+
+// What the clipping needs to know about the shape of a polygon, computed once when it's added.
+// In the coordinates of its original geometry, an affine transform doesn't change whether it's convex,
+// and it only flips the orientation when it mirrors the polygon
+struct PolygonShape
+{
+    Bounds bounds;
+    bool isConvex{};
+    bool isClockwise{};
+};
+
+PolygonShape classifyPolygon(std::span<const Vec2f> vertices);
+
+struct PolygonArray
+{
+    explicit PolygonArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : vertices(resource), vVertices(resource), ranges(resource), transforms(resource), shapes(resource), bounds(resource),
+          isSelected(resource), slots(resource), versions(resource), clippedVertices(resource), vClippedVertices(resource),
+          clippedSubPolygons(resource), clippedPolygons(resource), clippedStamps(resource) {}
+
+    void add(std::span<const Vec2f> polyVertices, uint32_t slot);
+    void remove(uint32_t idx); // Swap and pop, leaves the vertices of the polygon unused in the pool
+    void removeMarked(std::span<const uint8_t> marked);
+    void compactVertices();
+    void compactClippedVertices();
+    void reserve(size_t count, size_t vertexCount);
+
+    void draw(const DrawTarget& drawTarget, std::span<const uint32_t> idxs) const;
+    size_t updateClippedGeometry(const Window& win, const Viewport& vp, const ClippingOptions& options, std::span<const uint32_t> idxs, WorkerPool& pool);
+    void toViewportCoord(const Affine2D& transform);
+    void toViewportCoord(const Affine2D& transform, std::span<const uint32_t> idxs);
+    void toViewportCoord(uint32_t idx, const Affine2D& transform);
+    void writeViewportCoordToFile(std::ofstream& outputFile, const Affine2D& worldToViewport) const;
+    void applyTransform(uint32_t idx, const Affine2D& transform); // O(1), only composes it with the current one
+    void applyTransform(const Affine2D& transform); // To all polygons
+    void applyTransform(const Affine2D& transform, uint32_t first, uint32_t last); // To the ones in [first, last)
+    Vec2f getCenter(uint32_t idx) const;
+    bool isInside(uint32_t idx, const Window& win) const;
+    float getViewportDistance(uint32_t idx, Vec2f p) const; // From what's drawn of it, in viewport coordinates
+    bool isViewportInside(uint32_t idx, const Bounds& rect) const;
+
+    // Materializes the vertices of a polygon, in world coordinates, into a buffer. Pass the view of the window to get
+    // them in window coordinates instead
+    void getWorldVertices(uint32_t idx, std::vector<Vec2f>& out, const Affine2D& view = {}) const;
+
+    // As they were added, the transform of the polygon still has to be applied to them
+    std::span<const Vec2f> getVertices(uint32_t idx) const
     {
-        return "Polygon";
+        return {vertices.data() + ranges[idx].first, ranges[idx].count};
     }
 
-    std::vector<Point> vertices;
-    static inline uint32_t color{};
+    std::span<const Vec2f> getViewportVertices(uint32_t idx) const
+    {
+        return {vVertices.data() + ranges[idx].first, ranges[idx].count};
+    }
+
+    bool hasViewportCoord() const { return vVertices.size() == vertices.size(); }
+
+    bool hasClippedGeometry() const { return clippedStamps.size() == ranges.size(); }
+
+    // The cached result of a polygon is up to date when its stamp matches this one
+    uint64_t getClipStamp(uint32_t idx) const { return uint64_t(clipEpoch) << 32 | versions[idx]; }
+
+    // Whether the sub polygons of a polygon are still in the pool, even if they're out of date
+    bool isInClippedPool(uint32_t idx) const { return clippedStamps[idx] >> 32 == clipEpoch; }
+
+    size_t size() const { return ranges.size(); }
+
+    std::pmr::vector<Vec2f> vertices;  // Shared by all polygons, original geometry
+    std::pmr::vector<Vec2f> vVertices; // Viewport Coordinates, same layout as the vertices
+    std::pmr::vector<VertexRange> ranges;
+    std::pmr::vector<Affine2D> transforms; // Every transform applied to the polygon, composed, takes it to world Coordinates
+    std::pmr::vector<PolygonShape> shapes;
+    std::pmr::vector<Bounds> bounds; // World Coordinates, those of the shape under the transform of the polygon
+    std::pmr::vector<uint8_t> isSelected;
+    std::pmr::vector<uint32_t> slots;
+    std::pmr::vector<uint32_t> versions;
+    size_t unusedVertexCount{}; // Left behind by removed polygons
+
+    // Result of the last clipping, kept until the polygon, the window or the clipping options change.
+    // A polygon may be split into several sub polygons, which are stored in their own pool. The sub polygons
+    // of a polygon clipped again are appended to it, and the pool is compacted once most of it is wasted
+    std::pmr::vector<Vec2f> clippedVertices;  // Window Coordinates
+    std::pmr::vector<Vec2f> vClippedVertices; // Viewport Coordinates, same layout as the clipped vertices
+    std::pmr::vector<VertexRange> clippedSubPolygons; // Within the clipped vertices
+    std::pmr::vector<VertexRange> clippedPolygons;    // Sub polygons of each polygon, within the list above
+    std::pmr::vector<uint64_t> clippedStamps;         // Epoch and version of each polygon when it was clipped
+    uint32_t clipEpoch{}; // Incremented every time all of them have to be clipped again
+    size_t unusedClippedVertexCount{}; // Left behind by polygons that were clipped again
+    uint64_t clippedWindowVersion{};
+    uint64_t clippedViewportVersion{};
+    ClippingOptions clippedOptions;
 };
 
 } // namespace mirras
\ No newline at end of file
@@ -0,0 +1,368 @@
+#include "rasterizer.h"
+#include "objects.h"
+
+#ifdef MIRRAS_PNG_EXPORT
+    #define STB_IMAGE_WRITE_IMPLEMENTATION
+    #include <stb_image_write.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace mirras
+{
+static constexpr uint32_t tileSize = 64; // In pixels
+static constexpr size_t minShapesPerBinChunk = 4096;
+
+// A primitive taken to pixels, either a segment or a point, drawn as a square around p0, as ImGuiDrawBackend does
+struct RasterShape
+{
+    Vec2f p0, p1;
+    float halfWidth{}; // Of the stroke, at least half a pixel, thinner ones are drawn fainter instead. Half the side of points
+    float alphaScale{};
+    uint32_t color{};
+    bool isPoint{};
+
+    // Beyond this distance from the segment, or the center of the point, pixels aren't touched
+    float getExtent() const { return halfWidth + 0.5f; }
+
+    Bounds getBounds() const
+    {
+        float extent = getExtent();
+
+        return {{std::min(p0.x, p1.x) - extent, std::min(p0.y, p1.y) - extent},
+                {std::max(p0.x, p1.x) + extent, std::max(p0.y, p1.y) + extent}};
+    }
+
+    float distance(Vec2f p) const
+    {
+        if(isPoint)
+            return std::max(std::abs(p.x - p0.x), std::abs(p.y - p0.y));
+
+        Vec2f seg = p1 - p0;
+        Vec2f rel = p - p0;
+        float lengthSq = seg.x * seg.x + seg.y * seg.y;
+        float t = lengthSq > 0.f ? std::clamp((rel.x * seg.x + rel.y * seg.y) / lengthSq, 0.f, 1.f) : 0.f;
+        Vec2f d = rel - seg * t;
+
+        return std::sqrt(d.x * d.x + d.y * d.y);
+    }
+};
+
+/*
+    Liang Barsky, in double precision, unlike the one in clippingAlgorithms.h. Segments left unclipped may reach far
+    beyond the image, then the endpoints in float are too coarse to find the pixels along them. Returns false when
+    the segment lies outside the region
+*/
+static bool clipToRegion(Vec2f& p0, Vec2f& p1, const Bounds& region)
+{
+    double dx = double(p1.x) - p0.x;
+    double dy = double(p1.y) - p0.y;
+
+    double p[4] = {-dx, dx, -dy, dy};
+    double q[4] = {double(p0.x) - region.min.x, double(region.max.x) - p0.x, double(p0.y) - region.min.y, double(region.max.y) - p0.y};
+
+    double t0 = 0.0, t1 = 1.0;
+
+    for(int i = 0; i < 4; ++i)
+    {
+        if(p[i] == 0.0)
+        {
+            if(q[i] < 0.0)
+                return false;
+        }
+        else
+        if(p[i] < 0.0)
+            t0 = std::max(t0, q[i] / p[i]);
+        else
+            t1 = std::min(t1, q[i] / p[i]);
+    }
+
+    if(t0 > t1)
+        return false;
+
+    Vec2f start{float(p0.x + t0 * dx), float(p0.y + t0 * dy)};
+    Vec2f end{float(p0.x + t1 * dx), float(p0.y + t1 * dy)};
+
+    p0 = start;
+    p1 = end;
+
+    return true;
+}
+
+static void appendShapes(const DrawRecorder& recording, float scale, Bounds region, std::vector<RasterShape>& shapes)
+{
+    auto makeShape = [&](Vec2f p0, Vec2f p1, uint32_t color, float thickness)
+    {
+        float width = thickness * scale;
+
+        return RasterShape{.p0 = p0 * scale, .p1 = p1 * scale, .halfWidth = std::max(width, 1.f) / 2.f,
+                           .alphaScale = std::min(width, 1.f), .color = color};
+    };
+
+    auto appendSegment = [&](Vec2f p0, Vec2f p1, uint32_t color, float thickness)
+    {
+        auto shape = makeShape(p0, p1, color, thickness);
+
+        // A margin wider than the stroke, so that the cut ends don't show
+        float margin = shape.getExtent() + 1.f;
+        Bounds expanded{region.min - Vec2f{margin, margin}, region.max + Vec2f{margin, margin}};
+
+        if(clipToRegion(shape.p0, shape.p1, expanded))
+            shapes.push_back(shape);
+    };
+
+    for(const auto& primitive : recording.primitives)
+    {
+        auto vertices = recording.getVertices(primitive);
+
+        switch(primitive.type)
+        {
+        case DrawRecorder::PrimitiveType::Point:
+        {
+            auto shape = makeShape(vertices[0], vertices[0], primitive.color, primitive.thickness);
+            shape.halfWidth += primitive.radius * scale;
+            shape.isPoint = true;
+            shapes.push_back(shape);
+            break;
+        }
+        case DrawRecorder::PrimitiveType::Line:
+            appendSegment(vertices[0], vertices[1], primitive.color, primitive.thickness);
+            break;
+
+        case DrawRecorder::PrimitiveType::ClosedPolyline:
+            for(size_t i = 0; i < vertices.size(); ++i)
+                appendSegment(vertices[i], vertices[(i + 1) % vertices.size()], primitive.color, primitive.thickness);
+            break;
+        }
+    }
+}
+
+// Calls visit(tile) for the tiles the shape might cover, segments skip the tiles of their bounds they don't cross
+template<typename Func>
+static void forEachTile(const RasterShape& shape, uint32_t tilesX, uint32_t tilesY, Func&& visit)
+{
+    auto box = shape.getBounds();
+
+    if(box.max.x < 0.f || box.max.y < 0.f || box.min.x >= float(tilesX * tileSize) || box.min.y >= float(tilesY * tileSize))
+        return;
+
+    uint32_t minX = (uint32_t) std::max(box.min.x, 0.f) / tileSize;
+    uint32_t minY = (uint32_t) std::max(box.min.y, 0.f) / tileSize;
+    uint32_t maxX = (uint32_t) std::min(box.max.x, float(tilesX * tileSize - 1)) / tileSize;
+    uint32_t maxY = (uint32_t) std::min(box.max.y, float(tilesY * tileSize - 1)) / tileSize;
+
+    float reach = shape.getExtent() + tileSize * 0.7072f; // Half the diagonal of a tile
+
+    for(uint32_t y = minY; y <= maxY; ++y)
+    {
+        for(uint32_t x = minX; x <= maxX; ++x)
+        {
+            Vec2f center{(x + 0.5f) * tileSize, (y + 0.5f) * tileSize};
+
+            if(shape.isPoint || shape.distance(center) <= reach)
+                visit(y * tilesX + x);
+        }
+    }
+}
+
+// Blends the color over the pixel, which stays opaque. Red and blue are blended together, in fixed point
+static void blend(uint32_t& pixel, uint32_t color, float alpha)
+{
+    if(alpha >= 1.f)
+    {
+        pixel = color | IM_COL32_A_MASK;
+        return;
+    }
+
+    uint32_t a = uint32_t(alpha * 256.f + 0.5f);
+
+    uint32_t redBlue = (((pixel & 0xFF00FF) * (256 - a) + (color & 0xFF00FF) * a) >> 8) & 0xFF00FF;
+    uint32_t green = (((pixel & 0x00FF00) * (256 - a) + (color & 0x00FF00) * a) >> 8) & 0x00FF00;
+
+    pixel = IM_COL32_A_MASK | redBlue | green;
+}
+
+static void drawShape(const RasterShape& shape, Image& image, uint32_t tileX, uint32_t tileY)
+{
+    auto box = shape.getBounds();
+    float extent = shape.getExtent();
+    float colorAlpha = float(shape.color >> IM_COL32_A_SHIFT) / 255.f * shape.alphaScale;
+
+    // Clamped as floats first, a segment left unclipped may reach far beyond what an int holds
+    auto clampTo = [](float value, uint32_t min, uint32_t max) { return (int) std::clamp(value, float(min), float(max)); };
+
+    int x0 = clampTo(std::floor(box.min.x), tileX * tileSize, std::min((tileX + 1) * tileSize, image.width));
+    int y0 = clampTo(std::floor(box.min.y), tileY * tileSize, std::min((tileY + 1) * tileSize, image.height));
+    int x1 = clampTo(std::ceil(box.max.x) + 1, tileX * tileSize, std::min((tileX + 1) * tileSize, image.width));
+    int y1 = clampTo(std::ceil(box.max.y) + 1, tileY * tileSize, std::min((tileY + 1) * tileSize, image.height));
+
+    // Rows of a segment only go through the span where they're within reach of the line through it
+    Vec2f dir = shape.p1 - shape.p0;
+    float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+    Vec2f normal = length > 0.f ? Vec2f{-dir.y / length, dir.x / length} : Vec2f{};
+    bool hasSpans = !shape.isPoint && std::abs(normal.x) > 1e-3f;
+
+    // Same as RasterShape::distance, squared, with what doesn't change from pixel to pixel taken out
+    float invLengthSq = length > 0.f ? 1.f / (length * length) : 0.f;
+
+    auto getDistanceSq = [&](Vec2f p)
+    {
+        if(shape.isPoint)
+        {
+            float d = std::max(std::abs(p.x - shape.p0.x), std::abs(p.y - shape.p0.y));
+            return d * d;
+        }
+
+        Vec2f rel = p - shape.p0;
+        float t = std::clamp((rel.x * dir.x + rel.y * dir.y) * invLengthSq, 0.f, 1.f);
+        Vec2f d = rel - dir * t;
+
+        return d.x * d.x + d.y * d.y;
+    };
+
+    // Closer than this, pixels are fully covered
+    float solidDistanceSq = std::max(extent - 1.f, 0.f) * std::max(extent - 1.f, 0.f);
+
+    for(int y = y0; y < y1; ++y)
+    {
+        float centerY = y + 0.5f;
+        int spanX0 = x0, spanX1 = x1;
+
+        if(hasSpans)
+        {
+            float offset = normal.y * (centerY - shape.p0.y);
+            float a = (-extent - offset) / normal.x + shape.p0.x;
+            float b = (extent - offset) / normal.x + shape.p0.x;
+
+            spanX0 = clampTo(std::floor(std::min(a, b)) - 1, x0, x1);
+            spanX1 = clampTo(std::ceil(std::max(a, b)) + 1, x0, x1);
+        }
+
+        uint32_t* row = image.pixels.data() + size_t(y) * image.width;
+
+        for(int x = spanX0; x < spanX1; ++x)
+        {
+            float distanceSq = getDistanceSq({x + 0.5f, centerY});
+
+            if(distanceSq >= extent * extent)
+                continue;
+
+            float coverage = distanceSq <= solidDistanceSq ? 1.f : std::min(extent - std::sqrt(distanceSq), 1.f);
+
+            blend(row[x], shape.color, coverage * colorAlpha);
+        }
+    }
+}
+
+Image rasterize(const DrawRecorder& recording, const RasterOptions& options, WorkerPool& pool)
+{
+    Image image{options.width, options.height, std::vector<uint32_t>(size_t(options.width) * options.height, options.background)};
+
+    if(options.width == 0 || options.height == 0)
+        return image;
+
+    std::vector<RasterShape> shapes;
+    appendShapes(recording, options.scale, {{0.f, 0.f}, {float(options.width), float(options.height)}}, shapes);
+
+    uint32_t tilesX = (options.width + tileSize - 1) / tileSize;
+    uint32_t tilesY = (options.height + tileSize - 1) / tileSize;
+    size_t tileCount = size_t(tilesX) * tilesY;
+
+    // Binning in two passes over the same chunks of shapes, counting and then placing them, so that each chunk
+    // writes to its own part of each bin, and the shapes end up in the order they were recorded.
+    // A long segment can be in hundreds of tiles of a large image, so the entries are counted in 64 bits
+    size_t chunkCount = pool.getChunkCount(shapes.size(), minShapesPerBinChunk);
+    std::vector<size_t> chunkOffsets(chunkCount * tileCount);
+
+    pool.parallelForChunks(shapes.size(), minShapesPerBinChunk, [&](size_t chunk, size_t first, size_t last)
+    {
+        size_t* counts = chunkOffsets.data() + chunk * tileCount;
+
+        for(size_t i = first; i < last; ++i)
+            forEachTile(shapes[i], tilesX, tilesY, [&](size_t tile) { ++counts[tile]; });
+    });
+
+    std::vector<size_t> tileStarts(tileCount + 1);
+    size_t entryCount{};
+
+    for(size_t tile = 0; tile < tileCount; ++tile)
+    {
+        tileStarts[tile] = entryCount;
+
+        for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            size_t count = chunkOffsets[chunk * tileCount + tile];
+            chunkOffsets[chunk * tileCount + tile] = entryCount;
+            entryCount += count;
+        }
+    }
+
+    tileStarts[tileCount] = entryCount;
+
+    std::vector<uint32_t> tileEntries(entryCount);
+
+    pool.parallelForChunks(shapes.size(), minShapesPerBinChunk, [&](size_t chunk, size_t first, size_t last)
+    {
+        size_t* offsets = chunkOffsets.data() + chunk * tileCount;
+
+        for(size_t i = first; i < last; ++i)
+            forEachTile(shapes[i], tilesX, tilesY, [&](size_t tile) { tileEntries[offsets[tile]++] = (uint32_t) i; });
+    });
+
+    pool.parallelFor(tileCount, 1, [&](size_t first, size_t last)
+    {
+        for(size_t tile = first; tile < last; ++tile)
+        {
+            for(size_t e = tileStarts[tile]; e < tileStarts[tile + 1]; ++e)
+                drawShape(shapes[tileEntries[e]], image, uint32_t(tile % tilesX), uint32_t(tile / tilesX));
+        }
+    });
+
+    return image;
+}
+
+bool writePPM(const Image& image, const char* path)
+{
+    std::ofstream file{path, std::ios::binary};
+
+    if(!file)
+        return false;
+
+    file << "P6\n" << image.width << ' ' << image.height << "\n255\n";
+
+    std::vector<char> row(size_t(image.width) * 3);
+
+    for(uint32_t y = 0; y < image.height; ++y)
+    {
+        for(uint32_t x = 0; x < image.width; ++x)
+        {
+            uint32_t pixel = image.pixels[size_t(y) * image.width + x];
+
+            row[x * 3 + 0] = char(pixel >> IM_COL32_R_SHIFT);
+            row[x * 3 + 1] = char(pixel >> IM_COL32_G_SHIFT);
+            row[x * 3 + 2] = char(pixel >> IM_COL32_B_SHIFT);
+        }
+
+        file.write(row.data(), row.size());
+    }
+
+    return bool(file);
+}
+
+bool writePNG(const Image& image, const char* path)
+{
+#ifdef MIRRAS_PNG_EXPORT
+    // ImGui's packing puts the channels in RGBA order in memory on little endian machines, as stb expects them
+    static_assert(IM_COL32_R_SHIFT == 0);
+
+    return stbi_write_png(path, (int) image.width, (int) image.height, 4, image.pixels.data(), (int) image.width * 4) != 0;
+#else
+    (void) image;
+    (void) path;
+    return false;
+#endif
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "drawBackend.h"
+#include "workerPool.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace mirras
+{
+struct Image
+{
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<uint32_t> pixels; // Packed as ImGui's colors (red in the lowest byte), row by row from the top
+};
+
+struct RasterOptions
+{
+    uint32_t width{};
+    uint32_t height{};
+    float scale = 1.f; // From the coordinates of the recording to pixels, the thickness of the lines included
+    uint32_t background = IM_COL32_BLACK;
+};
+
+/*
+    Software rasterizer for what the objects were drawn as, so that the viewport can be rendered to an image at any
+    size, without a display nor a GPU. The primitives are split into segments and points, which are binned into square
+    tiles of the image, keeping their order within each tile. The tiles are then filled at the same time on the
+    worker pool, each by a single thread, so no two threads ever write the same pixel and the image is the same for
+    any number of threads. Edges are anti-aliased from the distance of each pixel to the primitive, only going
+    through the pixels of each row the primitive might cover
+*/
+Image rasterize(const DrawRecorder& recording, const RasterOptions& options, WorkerPool& pool = g_WorkerPool);
+
+// Binary PPM (P6), which needs no library
+bool writePPM(const Image& image, const char* path);
+
+// Only when stb_image_write was found at build time, see MIRRAS_PNG_EXPORT
+bool writePNG(const Image& image, const char* path);
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "representation.h"
+
+#include <glfwpp/glfwpp.h>
+#include <imgui.h>
+#include <imgui_internal.h> // For the input events ImGui has queued
+
+#include <algorithm>
+#include <atomic>
+
+namespace mirras
+{
+/*
+    Decides whether the next frame has to be drawn, so that the application can wait for events while nothing
+    changes, rather than drawing the same frame at every v-sync. A frame is drawn when ImGui got input, from any of
+    its windows, when the world, the window or the viewport changed since the last frame, or when something else
+    asked for it with requestRedraw, like the window being resized or uncovered. ImGui takes a couple of frames to
+    settle after some input (windows being focused, popups opening), so input is followed by a few frames.
+    While a text field is active, frames keep being drawn at the pace of its blinking cursor
+*/
+class RedrawTracker
+{
+public:
+    // Safe to call from any thread, the UI thread is woken up if it's waiting for events
+    void requestRedraw(int frameCount = 1)
+    {
+        int pending = pendingFrames.load();
+
+        while(pending < frameCount && !pendingFrames.compare_exchange_weak(pending, frameCount)) {}
+
+        glfw::postEmptyEvent();
+    }
+
+    // Waits until something might have to be drawn, or just takes the events when drawing every frame
+    void waitEvents() const
+    {
+        if(isOnDemand)
+            glfw::waitEvents(ImGui::GetIO().WantTextInput ? textCursorTimeout : idleTimeout);
+        else
+            glfw::pollEvents();
+    }
+
+    // Must be called once per iteration of the main loop, right after taking the events
+    bool shouldDrawFrame()
+    {
+        StateVersions current{g_World.getId(), g_World.getVersion(), g_Window.version, g_Viewport.version};
+
+        bool hasStateChanged = current != drawnVersions;
+        drawnVersions = current;
+
+        const auto& io = ImGui::GetIO();
+
+        if(GImGui->InputEventsQueue.Size > 0)
+            requestRedraw(settleFrames);
+
+        bool isMouseDown = std::ranges::any_of(io.MouseDown, [](bool isDown) { return isDown; });
+
+        bool shouldDraw = !isOnDemand || hasStateChanged || isMouseDown || io.WantTextInput || pendingFrames.load() > 0;
+
+        if(shouldDraw)
+        {
+            int pending = pendingFrames.load();
+
+            while(pending > 0 && !pendingFrames.compare_exchange_weak(pending, pending - 1)) {}
+
+            ++drawnFrames;
+        }
+
+        return shouldDraw;
+    }
+
+    uint64_t getDrawnFrames() const { return drawnFrames; }
+
+    bool isOnDemand = true; // Otherwise every frame is drawn
+
+private:
+    static constexpr int settleFrames = 3;
+    static constexpr double idleTimeout = 0.5;         // In seconds, in case something changed without asking for a redraw
+    static constexpr double textCursorTimeout = 0.25;  // Somewhat faster than the cursor blinks
+
+    struct StateVersions
+    {
+        uint64_t worldId{};
+        uint64_t worldVersion{};
+        uint64_t windowVersion{};
+        uint64_t viewportVersion{};
+
+        friend bool operator== (const StateVersions&, const StateVersions&) = default;
+    };
+
+    std::atomic<int> pendingFrames{settleFrames};
+    StateVersions drawnVersions;
+    uint64_t drawnFrames{};
+};
+
+inline RedrawTracker g_RedrawTracker;
+
+} // namespace mirras
\ No newline at end of file
@@ -1,5 +1,14 @@
 #pragma once
 
+#include "objects.h"
+#include "sceneArena.h"
+#include "workerPool.h"
+#include "spatialIndex.h"
+
+#include <array>
+#include <memory>
+#include <optional>
+
 // Classes to represent the world and ways to visualize it 
 
 namespace mirras
@@ -12,37 +21,791 @@ public:
         return (wmin + wmax + Vec2f{wmin.x, wmax.y} + Vec2f{wmax.x, wmin.y}) / 4.f;
     }
 
-    void applyTransform(const glm::mat4& transform)
+    void applyTransform(const Affine2D& transform)
+    {
+        wmin = transform.apply(wmin);
+        wmax = transform.apply(wmax);
+        ++version;
+    }
+
+    void translate(Vec2f offset)
     {
-        Point pwmin = {wmin.x, wmin.y};
-        Point pwmax = {wmax.x, wmax.y};
+        wmin = wmin + offset;
+        wmax = wmax + offset;
+        ++version;
+    }
 
-        pwmin.applyTransform(transform);
-        pwmax.applyTransform(transform);
+    // Rotates the window around its center, counterclockwise. Only the view transform changes, the world is left
+    // untouched, so the cost doesn't depend on the number of objects
+    void rotate(float angle)
+    {
+        view = Affine2D::rotation(-angle, getCenter()) * view;
+        angleRotatedSoFar += angle;
+        ++version;
+    }
 
-        wmin = pwmin;
-        wmax = pwmax;
+    // Back to the initial position and orientation
+    void reset()
+    {
+        wmin = iniWmin;
+        wmax = iniWmax;
+        view = {};
+        angleRotatedSoFar = 0.f;
+        ++version;
+    }
+
+    // From world to window coordinates, in which wmin and wmax are expressed
+    Vec2f toWindowCoord(Vec2f p) const
+    {
+        return view.apply(p);
+    }
+
+    // Where a box in world coordinates lies relative to the window, with a single test of its bounds in window
+    // coordinates. When the window is rotated these contain the box, so it may be deemed partial while being outside
+    Overlap classify(const Bounds& box) const
+    {
+        return classifyBounds(transformBounds(box, view), {wmin, wmax});
+    }
+
+    // Contain the window, in world coordinates
+    Bounds getWorldBounds() const
+    {
+        return transformBounds({wmin, wmax}, view.inverse());
+    }
+
+    // Where the window is in the world, rotated along with it, counterclockwise from wmin
+    std::array<Vec2f, 4> getWorldCorners() const
+    {
+        auto windowToWorld = view.inverse();
+
+        return {windowToWorld.apply(wmin), windowToWorld.apply({wmax.x, wmin.y}), windowToWorld.apply(wmax), windowToWorld.apply({wmin.x, wmax.y})};
+    }
+
+    // From world coordinates straight to the viewport
+    Affine2D worldToViewport(Vec2f vmin, Vec2f vmax) const
+    {
+        return windowToViewport(wmin, wmax, vmin, vmax) * view;
     }
 
     Vec2f wmin{}, wmax{};
     Vec2f iniWmin{}, iniWmax{};
+    Affine2D view; // World to window coordinates, holds the rotations of the window
     float angleRotatedSoFar{0.f};
+    uint64_t version{}; // Incremented every time the window moves
 };
 
 class Viewport
 {
 public:
+    void setSize(float _width, float _height)
+    {
+        if(width == _width && height == _height)
+            return;
+
+        width = _width;
+        height = _height;
+        ++version;
+    }
+
     float width{}, height{};
     float borderW{}, borderH{};
+    uint64_t version{}; // Incremented every time the viewport is resized
+};
+
+enum class ObjectType : uint8_t
+{
+    Point,
+    LineSegment,
+    Polygon
+};
+
+// Identifies an object inside the type partitioned storage of the World.
+// It is only valid until some object of the same type is removed, prefer ObjectHandle to keep track of objects
+struct ObjectRef
+{
+    ObjectType type{};
+    uint32_t idx{};
+};
+
+struct ViewportMappingStats
+{
+    size_t recomputedObjects{};
+    bool wasFullRecompute{};
+};
+
+// How many segments the batched Cohen Sutherland settled with their outcodes alone, and how many it had to clip
+struct LineClippingStats
+{
+    size_t trivialAccepts{};
+    size_t trivialRejects{};
+    size_t clipped{};
+};
+
+// Objects found by a query of the spatial index, by type. Indices into each array, in increasing order
+struct ObjectsInRegion
+{
+    explicit ObjectsInRegion(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : points(resource), lines(resource), polygons(resource) {}
+
+    size_t size() const { return points.size() + lines.size() + polygons.size(); }
+
+    std::pmr::vector<uint32_t> points;
+    std::pmr::vector<uint32_t> lines;
+    std::pmr::vector<uint32_t> polygons;
+};
+
+// Stable way to refer to an object, it stays valid while the object exists, no matter what else is removed.
+// The generation tells apart objects that reused the same slot, so handles to removed objects are detected
+struct ObjectHandle
+{
+    static constexpr uint32_t invalidIdx = UINT32_MAX;
+
+    uint32_t idx{invalidIdx}; // Slot in the World's slot map
+    uint32_t generation{};
+
+    friend bool operator== (ObjectHandle, ObjectHandle) = default;
 };
 
 class World
 {
 public:
-    std::vector<std::unique_ptr<Object>> objects;
+    World() : arena(std::make_unique<SceneArena>()),
+              points(arena->resource()), lines(arena->resource()), polygons(arena->resource()),
+              slots(arena->resource()), freeSlots(arena->resource()), dirtyObjs(arena->resource()),
+              changedObjs(arena->resource()), spatialIndex(arena->resource()), visibleObjs(arena->resource()) {}
+
+    World(World&&) noexcept = default;
+
+    // The arrays of both worlds allocate from different arenas, so instead of moving element by element
+    // into the old arena, we drop the old scene as a whole and take over the arena of the other one
+    World& operator=(World&& other) noexcept
+    {
+        if(this != &other)
+        {
+            std::destroy_at(this);
+            std::construct_at(this, std::move(other));
+        }
+
+        return *this;
+    }
+
+    ObjectHandle add(const Point& point)
+    {
+        auto[handle, slot] = allocateSlot({ObjectType::Point, (uint32_t) points.size()});
+        points.add(point, slot);
+        markDirty(handle);
+        markChanged(handle);
+        updateSpatialIndex(handle);
+        return handle;
+    }
+
+    ObjectHandle add(const LineSegment& line)
+    {
+        auto[handle, slot] = allocateSlot({ObjectType::LineSegment, (uint32_t) lines.size()});
+        lines.add(line, slot);
+        markDirty(handle);
+        markChanged(handle);
+        updateSpatialIndex(handle);
+        return handle;
+    }
+
+    ObjectHandle add(std::span<const Vec2f> polyVertices)
+    {
+        auto[handle, slot] = allocateSlot({ObjectType::Polygon, (uint32_t) polygons.size()});
+        polygons.add(polyVertices, slot);
+        markDirty(handle);
+        markChanged(handle);
+        updateSpatialIndex(handle);
+        return handle;
+    }
+
+    ObjectHandle add(const Polygon& poly) { return add(std::span<const Vec2f>{poly.vertices}); }
+
+    bool isAlive(ObjectHandle handle) const
+    {
+        return handle.idx < slots.size() && slots[handle.idx].generation == handle.generation;
+    }
+
+    ObjectRef getRef(ObjectHandle handle) const
+    {
+        assert(isAlive(handle));
+        return slots[handle.idx].ref;
+    }
+
+    ObjectHandle getHandle(ObjectRef ref) const
+    {
+        uint32_t slot = getSlotsOf(ref.type)[ref.idx];
+        return {slot, slots[slot].generation};
+    }
+
+    // O(1), the last object of the same type takes the place of the removed one
+    void remove(ObjectHandle handle)
+    {
+        if(!isAlive(handle))
+            return;
+
+        auto ref = getRef(handle);
+
+        spatialIndex.remove(handle.idx);
+        markChanged(handle);
+        areVisibleObjsStale = true; // Other objects might have been moved within their array
+
+        switch(ref.type)
+        {
+        case ObjectType::Point:       points.remove(ref.idx); break;
+        case ObjectType::LineSegment: lines.remove(ref.idx); break;
+        case ObjectType::Polygon:     polygons.remove(ref.idx); break;
+        }
+
+        const auto& typeSlots = getSlotsOf(ref.type);
+
+        if(ref.idx < typeSlots.size()) // Some object was moved into the removed position
+            slots[typeSlots[ref.idx]].ref.idx = ref.idx;
+
+        freeSlot(handle.idx);
+    }
+
+    // Removes all the objects at once, with a single compaction pass over each array
+    void remove(std::span<const ObjectHandle> handles)
+    {
+        // Scratch, taken from the heap rather than from the arena, which would keep it for as long as the scene
+        std::vector<uint8_t> markedPoints(points.size(), 0);
+        std::vector<uint8_t> markedLines(lines.size(), 0);
+        std::vector<uint8_t> markedPolygons(polygons.size(), 0);
+
+        for(auto handle : handles)
+        {
+            if(!isAlive(handle))
+                continue;
+
+            auto ref = getRef(handle);
+
+            switch(ref.type)
+            {
+            case ObjectType::Point:       markedPoints[ref.idx] = 1; break;
+            case ObjectType::LineSegment: markedLines[ref.idx] = 1; break;
+            case ObjectType::Polygon:     markedPolygons[ref.idx] = 1; break;
+            }
+
+            spatialIndex.remove(handle.idx);
+            markChanged(handle);
+            freeSlot(handle.idx);
+        }
+
+        areVisibleObjsStale = true;
+
+        points.removeMarked(markedPoints);
+        lines.removeMarked(markedLines);
+        polygons.removeMarked(markedPolygons);
+
+        // The remaining objects were moved back, update where their slots point to
+        for(auto type : {ObjectType::Point, ObjectType::LineSegment, ObjectType::Polygon})
+        {
+            const auto& typeSlots = getSlotsOf(type);
+
+            for(uint32_t i = 0; i < typeSlots.size(); ++i)
+                slots[typeSlots[i]].ref.idx = i;
+        }
+    }
+
+    size_t size() const
+    {
+        return points.size() + lines.size() + polygons.size();
+    }
+
+    // Objects are listed type by type: first the points, then the line segments and lastly the polygons
+    ObjectRef getRef(size_t idx) const
+    {
+        if(idx < points.size())
+            return {ObjectType::Point, (uint32_t) idx};
+
+        idx -= points.size();
+
+        if(idx < lines.size())
+            return {ObjectType::LineSegment, (uint32_t) idx};
+
+        return {ObjectType::Polygon, uint32_t(idx - lines.size())};
+    }
+
+    const char* getTypeName(ObjectRef ref) const
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       return "Point";
+        case ObjectType::LineSegment: return "Line";
+        case ObjectType::Polygon:     return "Polygon";
+        }
+        return "";
+    }
+
+    // In world coordinates, a point is its own box
+    Bounds getBounds(ObjectRef ref) const
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       return {points.positions[ref.idx], points.positions[ref.idx]};
+        case ObjectType::LineSegment: return lines.bounds[ref.idx];
+        case ObjectType::Polygon:     return polygons.bounds[ref.idx];
+        }
+        return {};
+    }
+
+    Vec2f getCenter(ObjectRef ref) const
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       return points.getCenter(ref.idx);
+        case ObjectType::LineSegment: return lines.getCenter(ref.idx);
+        case ObjectType::Polygon:     return polygons.getCenter(ref.idx);
+        }
+        return {};
+    }
+
+    void applyTransform(ObjectRef ref, const Affine2D& transform)
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       points.applyTransform(ref.idx, transform); break;
+        case ObjectType::LineSegment: lines.applyTransform(ref.idx, transform); break;
+        case ObjectType::Polygon:     polygons.applyTransform(ref.idx, transform); break;
+        }
+
+        markDirty(getHandle(ref));
+        markChanged(getHandle(ref));
+        updateSpatialIndex(getHandle(ref));
+    }
+
+    /*
+        To all objects. Each array is split into chunks run by the pool, as every object is transformed on its own,
+        the result is the same as transforming them one after the other (a pool without workers does just that)
+    */
+    void applyTransform(const Affine2D& transform, WorkerPool& pool = g_WorkerPool)
+    {
+        pool.parallelFor(points.size(), minPointsPerChunk, [&](size_t first, size_t last)
+        {
+            points.applyTransform(transform, (uint32_t) first, (uint32_t) last);
+        });
+
+        pool.parallelFor(lines.size(), minLinesPerChunk, [&](size_t first, size_t last)
+        {
+            lines.applyTransform(transform, (uint32_t) first, (uint32_t) last);
+        });
+
+        pool.parallelFor(polygons.size(), minPolygonsPerChunk, [&](size_t first, size_t last)
+        {
+            polygons.applyTransform(transform, (uint32_t) first, (uint32_t) last);
+        });
+
+        needsFullRemap = true;
+        haveManyChanged = true;
+        ++version;
+        areAllBoundsStale = true; // Taken in bulk once the index is needed
+        areVisibleObjsStale = true;
+    }
+
+    // To a selection of objects, in which none of them may appear twice
+    void applyTransform(std::span<const ObjectHandle> handles, const Affine2D& transform, WorkerPool& pool = g_WorkerPool)
+    {
+        pool.parallelFor(handles.size(), minObjectsPerChunk, [&](size_t first, size_t last)
+        {
+            for(size_t i = first; i < last; ++i)
+            {
+                if(!isAlive(handles[i]))
+                    continue;
+
+                auto ref = getRef(handles[i]);
+
+                switch(ref.type)
+                {
+                case ObjectType::Point:       points.applyTransform(ref.idx, transform); break;
+                case ObjectType::LineSegment: lines.applyTransform(ref.idx, transform); break;
+                case ObjectType::Polygon:     polygons.applyTransform(ref.idx, transform); break;
+                }
+            }
+        });
+
+        // The dirty list and the index aren't thread safe, but they're cheap compared to the transforms
+        for(auto handle : handles)
+        {
+            if(isAlive(handle))
+            {
+                markDirty(handle);
+                markChanged(handle);
+                updateSpatialIndex(handle);
+            }
+        }
+    }
+
+    // Finds the objects whose bounds overlap the region, in world coordinates, through the spatial index
+    void findObjectsIn(const Bounds& region, ObjectsInRegion& found)
+    {
+        refreshSpatialIndex();
+
+        found.points.clear();
+        found.lines.clear();
+        found.polygons.clear();
+
+        spatialIndex.query(region, [&](uint32_t slot)
+        {
+            auto ref = slots[slot].ref;
+
+            switch(ref.type)
+            {
+            case ObjectType::Point:       found.points.push_back(ref.idx); break;
+            case ObjectType::LineSegment: found.lines.push_back(ref.idx); break;
+            case ObjectType::Polygon:     found.polygons.push_back(ref.idx); break;
+            }
+        });
+
+        // Going through the arrays in order is friendlier to the cache
+        std::ranges::sort(found.points);
+        std::ranges::sort(found.lines);
+        std::ranges::sort(found.polygons);
+    }
+
+    /*
+        The objects that might show up in the region, in world coordinates, which contains the window. They're the only
+        ones mapped, clipped and drawn every frame, so the cost of a frame depends on how many objects are visible,
+        not on how many there are. Only looked up again when the region or some object changed
+    */
+    void updateVisibleObjects(const Bounds& region)
+    {
+        if(!areVisibleObjsStale && region == visibleRegion)
+            return;
+
+        findObjectsIn(region, visibleObjs);
+        visibleRegion = region;
+        areVisibleObjsStale = false;
+    }
+
+    const ObjectsInRegion& getVisibleObjects() const { return visibleObjs; }
+
+    /*
+        Keeps the viewport coordinates of the visible objects up to date. When the window or the viewport changed,
+        every visible object is mapped again with the batched kernels, otherwise only the objects edited since the
+        last call are, so an idle frame costs nothing and editing one object costs O(1).
+        An object that wasn't visible can only become visible if it's edited, or if the window or the viewport change,
+        so the visible ones are always mapped. Must come after updating the visible objects
+    */
+    ViewportMappingStats updateViewportCoord(const Window& win, const Viewport& vp)
+    {
+        auto transform = win.worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height});
+
+        bool fullRemap = needsFullRemap || win.version != mappedWindowVersion || vp.version != mappedViewportVersion;
+
+        ViewportMappingStats stats{.wasFullRecompute = fullRemap};
+
+        if(fullRemap)
+        {
+            points.toViewportCoord(transform, visibleObjs.points);
+            lines.toViewportCoord(transform, visibleObjs.lines);
+            polygons.toViewportCoord(transform, visibleObjs.polygons);
+
+            stats.recomputedObjects = visibleObjs.size();
+        }
+        else
+        {
+            for(auto handle : dirtyObjs)
+            {
+                if(!isAlive(handle)) // Removed after being edited
+                    continue;
+
+                auto ref = getRef(handle);
+
+                switch(ref.type)
+                {
+                case ObjectType::Point:       points.toViewportCoord(ref.idx, transform); break;
+                case ObjectType::LineSegment: lines.toViewportCoord(ref.idx, transform); break;
+                case ObjectType::Polygon:     polygons.toViewportCoord(ref.idx, transform); break;
+                }
+
+                ++stats.recomputedObjects;
+            }
+        }
+
+        dirtyObjs.clear();
+        needsFullRemap = false;
+        mappedWindowVersion = win.version;
+        mappedViewportVersion = vp.version;
+
+        return stats;
+    }
+
+    /*
+        Keeps the clipped geometry of the visible objects up to date. Each array clips again only the objects edited
+        since the last call, unless the window or the clipping options changed, so an idle frame costs nothing but
+        drawing. The polygons are clipped on the worker pool. The line clipping stats are filled in whenever Cohen
+        Sutherland runs. Returns how many objects were clipped. Must come after updating the visible objects
+    */
+    size_t updateClippedGeometry(const Window& win, const Viewport& vp, const ClippingOptions& options, LineClippingStats* lineStats = nullptr,
+                                 WorkerPool& pool = g_WorkerPool)
+    {
+        return lines.updateClippedGeometry(win, vp, options, visibleObjs.lines, lineStats)
+             + polygons.updateClippedGeometry(win, vp, options, visibleObjs.polygons, pool);
+    }
+
+    /*
+        Nearest visible object to a position in viewport coordinates, as long as it's within the tolerance, in pixels.
+        The candidates come from the spatial index, so it doesn't depend on how many objects there are. Measured on
+        what's drawn, so it must come after updating the viewport coordinates
+    */
+    std::optional<ObjectRef> pickObject(const Window& win, const Viewport& vp, Vec2f pos, float tolerance)
+    {
+        ObjectsInRegion candidates;
+        findVisibleObjectsIn(win, vp, {pos - Vec2f{tolerance, tolerance}, pos + Vec2f{tolerance, tolerance}}, candidates);
+
+        std::optional<ObjectRef> picked;
+        float nearest = tolerance;
+
+        auto pickNearest = [&](const auto& objs, std::span<const uint32_t> idxs, ObjectType type)
+        {
+            for(auto i : idxs)
+            {
+                float distance = objs.getViewportDistance(i, pos);
+
+                if(distance <= nearest)
+                {
+                    nearest = distance;
+                    picked = ObjectRef{type, i};
+                }
+            }
+        };
+
+        // Polygons first, so that a point or a segment on top of an edge wins the tie
+        pickNearest(polygons, candidates.polygons, ObjectType::Polygon);
+        pickNearest(lines, candidates.lines, ObjectType::LineSegment);
+        pickNearest(points, candidates.points, ObjectType::Point);
+
+        return picked;
+    }
+
+    // Visible objects lying entirely within a rectangle in viewport coordinates. Must come after updating them too
+    void findObjectsInRect(const Window& win, const Viewport& vp, const Bounds& rect, ObjectsInRegion& found)
+    {
+        findVisibleObjectsIn(win, vp, rect, found);
+
+        std::erase_if(found.points, [&](uint32_t i) { return !points.isViewportInside(i, rect); });
+        std::erase_if(found.lines, [&](uint32_t i) { return !lines.isViewportInside(i, rect); });
+        std::erase_if(found.polygons, [&](uint32_t i) { return !polygons.isViewportInside(i, rect); });
+    }
+
+    bool isSelected(ObjectRef ref) const
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       return points.isSelected[ref.idx];
+        case ObjectType::LineSegment: return lines.isSelected[ref.idx];
+        case ObjectType::Polygon:     return polygons.isSelected[ref.idx];
+        }
+        return false;
+    }
+
+    void setSelected(ObjectRef ref, bool isSelected)
+    {
+        switch(ref.type)
+        {
+        case ObjectType::Point:       points.isSelected[ref.idx] = isSelected; break;
+        case ObjectType::LineSegment: lines.isSelected[ref.idx] = isSelected; break;
+        case ObjectType::Polygon:     polygons.isSelected[ref.idx] = isSelected; break;
+        }
+
+        markChanged(getHandle(ref));
+    }
+
+    /*
+        For what is kept across frames in terms of the objects, like the cached draw list. Lists the objects added,
+        removed, edited or (de)selected since the last call. Returns false, listing nothing, when too many of them
+        changed to be worth listing, so everything should be taken as changed. Objects only moved within their
+        array by a removal aren't listed, they keep their slot
+    */
+    bool takeChangedObjects(std::vector<ObjectHandle>& out)
+    {
+        out.assign(changedObjs.begin(), changedObjs.end());
+        changedObjs.clear();
+
+        bool wereListed = !haveManyChanged;
+        haveManyChanged = false;
+
+        return wereListed;
+    }
+
+    // Tells worlds apart, a world taking the place of another one (when loading a file) keeps its own id
+    uint64_t getId() const { return id; }
+
+    // Changes whenever anything that is drawn of the world does, any object being added, removed, edited or (de)selected
+    uint64_t getVersion() const { return version; }
+
+    void reserve(size_t pointCount, size_t lineCount, size_t polygonCount, size_t polygonVertexCount)
+    {
+        slots.reserve(pointCount + lineCount + polygonCount);
+        points.reserve(pointCount);
+        lines.reserve(lineCount);
+        polygons.reserve(polygonCount, polygonVertexCount);
+    }
+
+    // Declared before everything else, as it must outlive them
+    std::unique_ptr<SceneArena> arena;
+
+    PointArray points;
+    LineSegmentArray lines;
+    PolygonArray polygons;
+
+private:
+    // Below these, splitting costs more than it saves
+    static constexpr size_t minPointsPerChunk = 16 * 1024;
+    static constexpr size_t minLinesPerChunk = 8 * 1024;
+    static constexpr size_t minPolygonsPerChunk = 4 * 1024;
+    static constexpr size_t minObjectsPerChunk = 4 * 1024;
+
+    struct Slot
+    {
+        ObjectRef ref;
+        uint32_t generation{};
+    };
+
+    std::pair<ObjectHandle, uint32_t> allocateSlot(ObjectRef ref)
+    {
+        uint32_t slot;
+
+        if(freeSlots.empty())
+        {
+            slot = (uint32_t) slots.size();
+            slots.emplace_back(Slot{ref});
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slots[slot].ref = ref;
+        }
+
+        return {ObjectHandle{slot, slots[slot].generation}, slot};
+    }
+
+    void freeSlot(uint32_t slot)
+    {
+        ++slots[slot].generation; // Invalidates the handles to the old object
+        freeSlots.push_back(slot);
+    }
+
+    void markChanged(ObjectHandle handle)
+    {
+        ++version;
+
+        if(haveManyChanged)
+            return;
+
+        if(changedObjs.size() > size() / 4)
+        {
+            haveManyChanged = true;
+            changedObjs.clear();
+        }
+        else
+            changedObjs.push_back(handle);
+    }
+
+    void markDirty(ObjectHandle handle)
+    {
+        // No need to keep track of each object once all of them will be mapped again.
+        // Past some point, going through the objects one by one is also slower than mapping them all at once
+        if(needsFullRemap)
+            return;
+
+        if(dirtyObjs.size() > size() / 4)
+        {
+            needsFullRemap = true;
+            dirtyObjs.clear();
+        }
+        else
+            dirtyObjs.push_back(handle);
+    }
+
+    /*
+        Objects whose bounds overlap a region in viewport coordinates. The region is limited to the visible one,
+        as only the visible objects are sure to have their viewport coordinates up to date
+    */
+    void findVisibleObjectsIn(const Window& win, const Viewport& vp, const Bounds& vpRegion, ObjectsInRegion& found)
+    {
+        auto viewportToWorld = win.worldToViewport({vp.borderW, vp.borderH}, {vp.width, vp.height}).inverse();
+        auto region = transformBounds(vpRegion, viewportToWorld);
+
+        region.min = {std::max(region.min.x, visibleRegion.min.x), std::max(region.min.y, visibleRegion.min.y)};
+        region.max = {std::min(region.max.x, visibleRegion.max.x), std::min(region.max.y, visibleRegion.max.y)};
+
+        if(areVisibleObjsStale || region.min.x > region.max.x || region.min.y > region.max.y)
+        {
+            found.points.clear();
+            found.lines.clear();
+            found.polygons.clear();
+            return;
+        }
+
+        findObjectsIn(region, found);
+    }
+
+    void updateSpatialIndex(ObjectHandle handle)
+    {
+        spatialIndex.update(handle.idx, getBounds(getRef(handle)));
+        areVisibleObjsStale = true;
+    }
+
+    void refreshSpatialIndex()
+    {
+        if(areAllBoundsStale)
+        {
+            for(uint32_t i = 0; i < points.size(); ++i)
+                spatialIndex.setBounds(points.slots[i], {points.positions[i], points.positions[i]});
+
+            for(uint32_t i = 0; i < lines.size(); ++i)
+                spatialIndex.setBounds(lines.slots[i], lines.bounds[i]);
+
+            for(uint32_t i = 0; i < polygons.size(); ++i)
+                spatialIndex.setBounds(polygons.slots[i], polygons.bounds[i]);
+
+            spatialIndex.rebuild();
+            areAllBoundsStale = false;
+        }
+        else if(spatialIndex.needsRebuild())
+            spatialIndex.rebuild();
+    }
+
+    const std::pmr::vector<uint32_t>& getSlotsOf(ObjectType type) const
+    {
+        switch(type)
+        {
+        case ObjectType::Point:       return points.slots;
+        case ObjectType::LineSegment: return lines.slots;
+        default:                      return polygons.slots;
+        }
+    }
+
+    std::pmr::vector<Slot> slots;
+    std::pmr::vector<uint32_t> freeSlots;
+
+    // State of the viewport coordinates
+    std::pmr::vector<ObjectHandle> dirtyObjs; // Edited since the last update, might contain duplicates
+    bool needsFullRemap{true};
+    uint64_t mappedWindowVersion{};
+    uint64_t mappedViewportVersion{};
+
+    // See takeChangedObjects
+    std::pmr::vector<ObjectHandle> changedObjs;
+    bool haveManyChanged{true};
+    uint64_t version{};
+
+    static inline uint64_t lastId{};
+    uint64_t id{++lastId};
+
+    SpatialIndex spatialIndex; // Over the bounds of the objects, in world coordinates
+    bool areAllBoundsStale{};
+
+    ObjectsInRegion visibleObjs;
+    Bounds visibleRegion{};
+    bool areVisibleObjsStale{true};
 };
 
 inline World g_World;
+inline std::vector<ObjectHandle> g_SelectedObjs; // Might hold removed objects, which are skipped
 inline Window g_Window;
 inline Viewport g_Viewport;
 
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory_resource>
+
+namespace mirras
+{
+/*
+    Owns all the memory of a scene (objects and vertex storage). Small buffers are handed out from big monotonic
+    blocks, with a pool resource on top of them that keeps free lists per block size, so the buffers released while
+    editing the scene are reused. Those blocks are only given back when the whole arena is dropped.
+    Large buffers (the arrays of a big scene, the grid of the spatial index) are allocated and freed one by one
+    from the heap instead, as they are the ones that get regrown or rebuilt while the scene is edited, and a
+    monotonic resource would keep every old copy of them until the scene is dropped
+*/
+class SceneArena
+{
+public:
+    SceneArena() = default;
+
+    SceneArena(const SceneArena&) = delete;
+    SceneArena& operator=(const SceneArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &router; }
+
+private:
+    static constexpr size_t initialBlockSize = 64 * 1024;
+    static constexpr size_t largestPooledBlock = 64 * 1024; // Bigger buffers come from the heap
+
+    // Sends each allocation to the pools or to the heap, depending on its size
+    class Router : public std::pmr::memory_resource
+    {
+    public:
+        explicit Router(std::pmr::memory_resource* pools) : pools(pools) {}
+
+    private:
+        std::pmr::memory_resource* upstreamFor(size_t bytes) const
+        {
+            return bytes <= largestPooledBlock ? pools : std::pmr::new_delete_resource();
+        }
+
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            return upstreamFor(bytes)->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            upstreamFor(bytes)->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        std::pmr::memory_resource* pools{};
+    };
+
+    std::pmr::monotonic_buffer_resource blocks{initialBlockSize};
+    std::pmr::unsynchronized_pool_resource pools{std::pmr::pool_options{0, largestPooledBlock}, &blocks};
+    Router router{&pools};
+};
+
+} // namespace mirras
\ No newline at end of file
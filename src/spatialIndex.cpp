@@ -0,0 +1,95 @@
+#include "spatialIndex.h"
+
+namespace mirras
+{
+void SpatialIndex::rebuild()
+{
+    looseSlots.clear();
+    largeSlots.clear();
+    cellStarts.clear();
+    cellEntries.clear();
+
+    Bounds extent{{INFINITY, INFINITY}, {-INFINITY, -INFINITY}};
+    double sizeSum{};
+
+    for(uint32_t slot = 0; slot < slotStates.size(); ++slot)
+    {
+        slotStates[slot].isLoose = false;
+
+        if(!slotStates[slot].isAlive)
+            continue;
+
+        extent.min = {std::min(extent.min.x, slotBounds[slot].min.x), std::min(extent.min.y, slotBounds[slot].min.y)};
+        extent.max = {std::max(extent.max.x, slotBounds[slot].max.x), std::max(extent.max.y, slotBounds[slot].max.y)};
+
+        sizeSum += std::max(slotBounds[slot].max.x - slotBounds[slot].min.x, slotBounds[slot].max.y - slotBounds[slot].min.y);
+    }
+
+    if(aliveCount == 0)
+        return;
+
+    // Square cells, as many as needed for a couple of objects in each, if they were spread evenly.
+    // No smaller than the objects on average, otherwise most of them would be stored in several cells
+    Vec2f size = {std::max(extent.max.x - extent.min.x, 1e-6f), std::max(extent.max.y - extent.min.y, 1e-6f)};
+    float cellSize = std::sqrt(size.x * size.y * objectsPerCell / (float) aliveCount);
+    cellSize = std::max(cellSize, float(sizeSum / aliveCount));
+
+    // Keeps a long and thin extent from having too many cells along its length
+    cellSize = std::max({cellSize, size.x / maxGridSide, size.y / maxGridSide});
+
+    origin = extent.min;
+    invCellSize = 1.f / cellSize;
+    gridWidth = std::clamp((uint32_t) std::ceil(size.x * invCellSize), 1u, maxGridSide);
+    gridHeight = std::clamp((uint32_t) std::ceil(size.y * invCellSize), 1u, maxGridSide);
+
+    // Count the entries of each cell first, so that all of them are stored in a single array
+    cellStarts.assign(size_t(gridWidth) * gridHeight + 1, 0);
+
+    auto forEachCellOf = [&](uint32_t slot, auto&& func)
+    {
+        auto[minX, minY] = toCell(slotBounds[slot].min);
+        auto[maxX, maxY] = toCell(slotBounds[slot].max);
+
+        for(uint32_t y = minY; y <= maxY; ++y)
+            for(uint32_t x = minX; x <= maxX; ++x)
+                func(y * gridWidth + x);
+    };
+
+    auto isLarge = [&](uint32_t slot)
+    {
+        auto[minX, minY] = toCell(slotBounds[slot].min);
+        auto[maxX, maxY] = toCell(slotBounds[slot].max);
+
+        return maxX - minX >= maxCellsPerObject || maxY - minY >= maxCellsPerObject;
+    };
+
+    for(uint32_t slot = 0; slot < slotStates.size(); ++slot)
+    {
+        if(!slotStates[slot].isAlive)
+            continue;
+
+        if(isLarge(slot))
+            largeSlots.push_back(slot);
+        else
+            forEachCellOf(slot, [&](uint32_t cell) { ++cellStarts[cell + 1]; });
+    }
+
+    for(size_t cell = 1; cell < cellStarts.size(); ++cell)
+        cellStarts[cell] += cellStarts[cell - 1];
+
+    cellEntries.resize(cellStarts.back());
+
+    // Fill each cell from its end, the starts end up where they were computed above.
+    // Scratch for this rebuild only, so it's taken from the heap rather than from the scene's arena
+    std::vector<uint32_t> cellEnds{cellStarts.begin() + 1, cellStarts.end()};
+
+    for(uint32_t slot = (uint32_t) slotStates.size(); slot-- > 0;)
+    {
+        if(!slotStates[slot].isAlive || isLarge(slot))
+            continue;
+
+        forEachCellOf(slot, [&](uint32_t cell) { cellEntries[--cellEnds[cell]] = {slotBounds[slot], slot}; });
+    }
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "objects.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory_resource>
+#include <vector>
+
+namespace mirras
+{
+/*
+    Uniform grid over the bounds of the objects, used to find the ones overlapping some region without going
+    through all of them. Objects are identified by their slot in the World's slot map, which doesn't change
+    while they're alive. The grid is built in one go, with the slots of each cell stored contiguously.
+    Objects added or moved afterwards are kept in a short list of loose objects, tested one by one on every
+    query, and the entries they left in the grid are ignored. Once that list grows too long, the grid is
+    built again. Objects larger than a few cells are also kept apart, so that none of them fills the grid.
+    Anything lying beyond the grid is stored in its border cells, so the grid never has to grow.
+*/
+class SpatialIndex
+{
+public:
+    explicit SpatialIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : slotBounds(resource), slotStates(resource), looseSlots(resource), largeSlots(resource),
+          cellStarts(resource), cellEntries(resource) {}
+
+    // For new objects as well as the ones that moved
+    void update(uint32_t slot, const Bounds& box)
+    {
+        if(slot >= slotBounds.size())
+        {
+            slotBounds.resize(slot + 1);
+            slotStates.resize(slot + 1);
+        }
+
+        slotBounds[slot] = box;
+
+        auto& state = slotStates[slot];
+
+        if(!state.isAlive)
+        {
+            state.isAlive = true;
+            ++aliveCount;
+        }
+
+        // A slot may be reused by a new object, the entries of the old one in the grid are then ignored too
+        if(!state.isLoose)
+        {
+            state.isLoose = true;
+            looseSlots.push_back(slot);
+        }
+    }
+
+    // Its entries, either in the grid or in the loose list, are ignored from now on
+    void remove(uint32_t slot)
+    {
+        slotStates[slot].isAlive = false;
+        --aliveCount;
+    }
+
+    // Past this point, testing the loose objects one by one costs more than building the grid again
+    bool needsRebuild() const
+    {
+        return looseSlots.size() > minLooseSlots && looseSlots.size() > aliveCount / 8;
+    }
+
+    // Only for when all the objects moved at once, right before building the grid again
+    void setBounds(uint32_t slot, const Bounds& box)
+    {
+        slotBounds[slot] = box;
+    }
+
+    void rebuild();
+
+    // Calls visit(slot) once for each object whose bounds overlap the region, in no particular order
+    template<typename Func>
+    void query(const Bounds& region, Func&& visit) const
+    {
+        auto overlaps = [&](const Bounds& box)
+        {
+            return box.max.x >= region.min.x && box.min.x <= region.max.x && box.max.y >= region.min.y && box.min.y <= region.max.y;
+        };
+
+        for(auto slot : looseSlots)
+        {
+            if(slotStates[slot].isAlive && overlaps(slotBounds[slot]))
+                visit(slot);
+        }
+
+        auto isInGrid = [&](uint32_t slot) { return slotStates[slot].isAlive && !slotStates[slot].isLoose; };
+
+        for(auto slot : largeSlots)
+        {
+            if(isInGrid(slot) && overlaps(slotBounds[slot]))
+                visit(slot);
+        }
+
+        if(cellStarts.empty())
+            return;
+
+        auto[minCellX, minCellY] = toCell(region.min);
+        auto[maxCellX, maxCellY] = toCell(region.max);
+
+        for(uint32_t y = minCellY; y <= maxCellY; ++y)
+        {
+            for(uint32_t x = minCellX; x <= maxCellX; ++x)
+            {
+                uint32_t cell = y * gridWidth + x;
+
+                for(uint32_t i = cellStarts[cell]; i < cellStarts[cell + 1]; ++i)
+                {
+                    const auto& entry = cellEntries[i];
+
+                    if(!overlaps(entry.box))
+                        continue;
+
+                    // An object spanning several cells is only reported by the first of them within the region
+                    auto[objCellX, objCellY] = toCell(entry.box.min);
+
+                    if(x == std::max(objCellX, minCellX) && y == std::max(objCellY, minCellY) && isInGrid(entry.slot))
+                        visit(entry.slot);
+                }
+            }
+        }
+    }
+
+private:
+    static constexpr size_t minLooseSlots = 256;
+    static constexpr uint32_t maxCellsPerObject = 16; // Along each axis
+    static constexpr uint32_t maxGridSide = 2048;
+    static constexpr float objectsPerCell = 2.f;
+
+    struct SlotState
+    {
+        bool isAlive{};
+        bool isLoose{}; // In the loose list, any entry of it in the grid is out of date
+    };
+
+    std::pair<uint32_t, uint32_t> toCell(Vec2f p) const
+    {
+        float x = std::clamp((p.x - origin.x) * invCellSize, 0.f, float(gridWidth - 1));
+        float y = std::clamp((p.y - origin.y) * invCellSize, 0.f, float(gridHeight - 1));
+
+        return {(uint32_t) x, (uint32_t) y};
+    }
+
+    std::pmr::vector<Bounds> slotBounds;
+    std::pmr::vector<SlotState> slotStates;
+    std::pmr::vector<uint32_t> looseSlots;
+    std::pmr::vector<uint32_t> largeSlots;
+    size_t aliveCount{};
+
+    // Grid
+    Vec2f origin{};
+    float invCellSize{};
+    uint32_t gridWidth{}, gridHeight{};
+    // The bounds are copied into the entries, so that a query reads the cells it goes through contiguously
+    struct CellEntry
+    {
+        Bounds box;
+        uint32_t slot{};
+    };
+
+    std::pmr::vector<uint32_t> cellStarts; // Entries of each cell, within the list below, one past the last cell too
+    std::pmr::vector<CellEntry> cellEntries;
+};
+
+} // namespace mirras
\ No newline at end of file
@@ -2,7 +2,6 @@
 
 #include <imgui.h>
 #include <pugixml.hpp>
-#include <glm/ext/matrix_transform.hpp>
 
 #include "imGuiLogger.h"
 #include "objects.h"
@@ -38,10 +37,14 @@ inline fs::path pathToConfigFile(const char* fileName)
     return {};
 }
 
+// All the objects are written, whether they're within the window or not, as they are without clipping
 inline void writeObjectsVpCoordToFile(std::ofstream& outputFile)
 {
-    for(const auto& obj : g_World.objects)
-        obj->writeViewportCoordToFile(outputFile);
+    auto worldToViewport = g_Window.worldToViewport({g_Viewport.borderW, g_Viewport.borderH}, {g_Viewport.width, g_Viewport.height});
+
+    g_World.points.writeViewportCoordToFile(outputFile, worldToViewport);
+    g_World.lines.writeViewportCoordToFile(outputFile, worldToViewport);
+    g_World.polygons.writeViewportCoordToFile(outputFile, worldToViewport);
 }
 
 struct XMLParsedData
@@ -51,9 +54,9 @@ struct XMLParsedData
     Viewport viewport;
 };
 
-inline Point retrievePoint(pxml::xml_node leaf)
+inline Vec2f retrievePoint(pxml::xml_node leaf)
 {
-    Point p;
+    Vec2f p;
     auto point = leaf.attributes();
     p.x = point.begin()->as_float();
     p.y = (++point.begin())->as_float();
@@ -61,13 +64,35 @@ inline Point retrievePoint(pxml::xml_node leaf)
     return p;
 }
 
-inline std::vector<Point> retrievePoints(pxml::xml_node parent)
+// Reuses the buffer passed in, to avoid allocating for each object while loading
+inline void retrievePoints(pxml::xml_node parent, std::vector<Vec2f>& points)
 {
-    std::vector<Point> points;
+    points.clear();
     for (auto child : parent.children())
         points.push_back(retrievePoint(child));
-    
-    return points;
+}
+
+// Count the objects up front, so that the arrays of the World are allocated only once
+inline void reserveWorldFor(World& world, pxml::xml_node root)
+{
+    size_t pointCount{}, lineCount{}, polygonCount{}, polygonVertexCount{};
+
+    for (auto child : root.children())
+    {
+        std::string_view name{child.name()};
+
+        if(name == "ponto")
+            ++pointCount;
+        else if(name == "reta")
+            ++lineCount;
+        else if(name == "poligono")
+        {
+            ++polygonCount;
+            polygonVertexCount += std::distance(child.children().begin(), child.children().end());
+        }
+    }
+
+    world.reserve(pointCount, lineCount, polygonCount, polygonVertexCount);
 }
 
 inline std::optional<XMLParsedData> loadDataFromXMLFile(const char* filePath)
@@ -87,33 +112,37 @@ inline std::optional<XMLParsedData> loadDataFromXMLFile(const char* filePath)
 
     g_Logger.AddLog("Parsing the file...\n");
 
-    for (auto child : doc.child("dados").children())
+    auto root = doc.child("dados");
+    reserveWorldFor(world, root);
+
+    std::vector<Vec2f> points;
+    points.reserve(16);
+
+    for (auto child : root.children())
     {
         std::string_view name{child.name()};
         g_Logger.AddLog("\t%s\n", child.name());
 
         if(name == "ponto")
         {
-            Point p = retrievePoint(child);
-            world.objects.emplace_back(std::make_unique<Point>(p));
+            world.add(Point{retrievePoint(child)});
         }
         else if(name == "reta")
         {
             LineSegment line;
-            auto points = retrievePoints(child);
+            retrievePoints(child, points);
             line.p0 = points[0];
             line.p1 = points[1];
-            world.objects.emplace_back(std::make_unique<LineSegment>(line));
+            world.add(line);
         }
         else if(name == "poligono")
         {
-            Polygon poly;
-            poly.vertices = retrievePoints(child);
-            world.objects.emplace_back(std::make_unique<Polygon>(std::move(poly)));
+            retrievePoints(child, points);
+            world.add(points);
         }
         else if(name == "viewport")
         {
-            auto points = retrievePoints(child);
+            retrievePoints(child, points);
             viewport.borderW = points[0].x;
             viewport.borderH = points[0].y;
             viewport.width = points[1].x;
@@ -121,7 +150,7 @@ inline std::optional<XMLParsedData> loadDataFromXMLFile(const char* filePath)
         }
         else if(name == "window")
         {
-            auto points = retrievePoints(child);
+            retrievePoints(child, points);
             window.wmin = points[0];
             window.wmax = points[1];
             // Initial pos
@@ -169,38 +198,51 @@ inline bool saveXMLFile(const char* fileName)
     wmax.append_attribute("x") = g_Window.wmax.x;
     wmax.append_attribute("y") = g_Window.wmax.y;
 
-    // Insert objects
-    for(const auto& obj : g_World.objects)
+    // Insert objects. The file format has no room for the orientation of the window, so the objects are saved
+    // as seen through it, in window coordinates (the same as the world ones while it's not rotated)
+    const auto& points = g_World.points;
+
+    for(size_t i = 0; i < points.size(); ++i)
     {
-        if(auto point = dynamic_cast<Point*>(obj.get()))
-        {
-            auto p = root.append_child("ponto");
+        auto p = root.append_child("ponto");
+        Vec2f pos = g_Window.toWindowCoord(points.positions[i]);
 
-            p.append_attribute("x") = point->x;
-            p.append_attribute("y") = point->y;
-        }
-        else if(auto line = dynamic_cast<LineSegment*>(obj.get()))
-        {
-            auto ln = root.append_child("reta");
+        p.append_attribute("x") = pos.x;
+        p.append_attribute("y") = pos.y;
+    }
 
-            auto p0 = ln.append_child("ponto");
-            p0.append_attribute("x") = line->p0.x;
-            p0.append_attribute("y") = line->p0.y;
+    const auto& lines = g_World.lines;
 
-            auto p1 = ln.append_child("ponto");
-            p1.append_attribute("x") = line->p1.x;
-            p1.append_attribute("y") = line->p1.y;
-        }
-        else if(auto polygon = dynamic_cast<Polygon*>(obj.get()))
+    for(size_t i = 0; i < lines.size(); ++i)
+    {
+        auto ln = root.append_child("reta");
+
+        Vec2f wP0 = g_Window.toWindowCoord(lines.p0[i]);
+        Vec2f wP1 = g_Window.toWindowCoord(lines.p1[i]);
+
+        auto p0 = ln.append_child("ponto");
+        p0.append_attribute("x") = wP0.x;
+        p0.append_attribute("y") = wP0.y;
+
+        auto p1 = ln.append_child("ponto");
+        p1.append_attribute("x") = wP1.x;
+        p1.append_attribute("y") = wP1.y;
+    }
+
+    const auto& polygons = g_World.polygons;
+    std::vector<Vec2f> polyVertices;
+
+    for(uint32_t i = 0; i < polygons.size(); ++i)
+    {
+        auto poly = root.append_child("poligono");
+
+        polygons.getWorldVertices(i, polyVertices, g_Window.view);
+
+        for(const auto& point : polyVertices)
         {
-            auto poly = root.append_child("poligono");
-
-            for(const auto& point : polygon->vertices)
-            {
-                auto p = poly.append_child("ponto");
-                p.append_attribute("x") = point.x;
-                p.append_attribute("y") = point.y;
-            }
+            auto p = poly.append_child("ponto");
+            p.append_attribute("x") = point.x;
+            p.append_attribute("y") = point.y;
         }
     }
 
@@ -261,46 +303,20 @@ inline bool ImGuiAlignedButton(ButtonType buttonType, const char* label, float a
     return false;
 }
 
-inline glm::mat4 rotateAroundCenter(Vec2f center, float angle)
+inline Affine2D rotateAroundCenter(Vec2f center, float angle)
 {
-    auto t1 = glm::translate(glm::mat4(1.f), glm::vec3(-center.x, -center.y, 0.f));
-    auto rot = glm::rotate(glm::mat4(1.f), glm::radians(angle), glm::vec3(0.f, 0.f, 1.f));
-    auto t2 = glm::translate(glm::mat4(1.f), glm::vec3(center.x, center.y, 0.f));
-
-    return t2 * rot * t1;
+    return Affine2D::rotation(angle, center);
 }
 
-inline glm::mat4 scaleAroundCenter(Vec2f center, float scaleFactor)
+inline Affine2D scaleAroundCenter(Vec2f center, float scaleFactor)
 {
-    auto t1 = glm::translate(glm::mat4(1.f), glm::vec3(-center.x, -center.y, 0.f));
-    auto s  = glm::scale(glm::mat4(1.f), glm::vec3(scaleFactor, scaleFactor, 0.f));
-    auto t2 = glm::translate(glm::mat4(1.f), glm::vec3(center.x, center.y, 0.f));
-
-    return t2 * s * t1;
+    return Affine2D::scale({scaleFactor, scaleFactor}, center);
 }
 
-inline Vec2f g_WinCenter;
-
+// Only the view of the window changes, the world coordinates are never touched
 inline void rotateWindow(float angle)
 {
-    if(g_Window.angleRotatedSoFar == 0.f)
-        g_WinCenter = g_Window.getCenter();
-
-    Vec2f winCenter = g_Window.getCenter();
-
-    // Calculate PPC
-    auto t = glm::translate(glm::mat4(1.f), glm::vec3(-winCenter.x, -winCenter.y, 0.f));
-    auto rot = glm::rotate(glm::mat4(1.f), glm::radians(-angle), glm::vec3(0.f, 0.f, 1.f));
-
-    auto ppc = rot * t;
-
-    g_Window.applyTransform(t);
-
-    // Apply PPC to all objects
-    for(auto& obj : g_World.objects)
-        obj->applyTransform(ppc);
-
-    g_Window.angleRotatedSoFar += angle;
+    g_Window.rotate(angle);
 }
 
 inline void scaleWindow(float scaleFactor)
@@ -313,22 +329,8 @@ inline void scaleWindow(float scaleFactor)
 }
 
 inline void resetWindow()
-{   
-    g_Window.wmin = g_Window.iniWmin;
-    g_Window.wmax = g_Window.iniWmax;
-
-    if(g_Window.angleRotatedSoFar == 0.f)
-        return;
-
-    auto t = glm::translate(glm::mat4(1.f), glm::vec3(g_WinCenter.x, g_WinCenter.y, 0.f));
-    auto rot = glm::rotate(glm::mat4(1.f), glm::radians(g_Window.angleRotatedSoFar), glm::vec3(0.f, 0.f, 1.f));
-
-    auto invPPC = t * rot;
-
-    for(auto& obj : g_World.objects)
-        obj->applyTransform(invPPC);
-
-    g_Window.angleRotatedSoFar = 0.f;
+{
+    g_Window.reset();
 }
 
 } // namespace mirras
\ No newline at end of file
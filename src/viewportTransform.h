@@ -0,0 +1,25 @@
+#pragma once
+
+#include "vec2f.h"
+#include "affine2d.h"
+
+namespace mirras
+{
+/*
+    Window to viewport mapping, with the ratios between both computed once, rather than for each vertex:
+
+        vX = (x - wmin.x) / (wmax.x - wmin.x) * vmax.x + vmin.x
+        vY = (1 - (y - wmin.y) / (wmax.y - wmin.y)) * vmax.y + vmin.y
+
+    ... which is the same as vX = x * sx + ox and vY = y * sy + oy. The window coordinates are the ones
+    after the view transform of the Window, combine both to go straight from world to viewport coordinates
+*/
+inline Affine2D windowToViewport(Vec2f wmin, Vec2f wmax, Vec2f vmin, Vec2f vmax)
+{
+    float sx = vmax.x / (wmax.x - wmin.x);
+    float sy = vmax.y / (wmax.y - wmin.y);
+
+    return {{sx, 0.f}, {0.f, -sy}, {vmin.x - wmin.x * sx, vmax.y + vmin.y + wmin.y * sy}};
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "workerPool.h"
+
+namespace mirras
+{
+WorkerPool::WorkerPool(unsigned workerCount)
+{
+    workers.reserve(workerCount);
+
+    for(unsigned i = 0; i < workerCount; ++i)
+        workers.emplace_back([this](std::stop_token stopToken) { workerLoop(stopToken); });
+}
+
+WorkerPool::~WorkerPool()
+{
+    for(auto& worker : workers)
+        worker.request_stop();
+
+    // jthread joins on destruction, the stop request wakes up the workers waiting for a batch
+    workers.clear();
+}
+
+void WorkerPool::run(size_t chunkCount, const std::function<void(size_t)>& job)
+{
+    {
+        std::lock_guard lock{mutex};
+
+        currentJob = &job;
+        currentChunkCount = chunkCount;
+        nextChunk = 0;
+        pendingChunks = chunkCount;
+        ++batchId;
+    }
+
+    batchReady.notify_all();
+
+    size_t done = runChunks(job, chunkCount);
+
+    // Workers still inside the batch may hold on to the job, so it has to outlive them
+    std::unique_lock lock{mutex};
+    pendingChunks -= done;
+    batchDone.wait(lock, [this] { return pendingChunks == 0 && activeWorkers == 0; });
+
+    currentJob = nullptr;
+}
+
+// Takes chunks of the batch until there are none left, returns how many were run
+size_t WorkerPool::runChunks(const std::function<void(size_t)>& job, size_t chunkCount)
+{
+    size_t done{};
+
+    for(size_t chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++)
+    {
+        job(chunk);
+        ++done;
+    }
+
+    return done;
+}
+
+void WorkerPool::workerLoop(std::stop_token stopToken)
+{
+    uint64_t lastBatch{};
+
+    while(true)
+    {
+        const std::function<void(size_t)>* job{};
+        size_t chunkCount{};
+
+        {
+            std::unique_lock lock{mutex};
+
+            if(!batchReady.wait(lock, stopToken, [&] { return batchId != lastBatch && currentJob; }))
+                return; // Stop requested
+
+            lastBatch = batchId;
+            job = currentJob;
+            chunkCount = currentChunkCount;
+            ++activeWorkers;
+        }
+
+        size_t done = runChunks(*job, chunkCount);
+
+        std::lock_guard lock{mutex};
+        pendingChunks -= done;
+        --activeWorkers;
+
+        if(pendingChunks == 0 && activeWorkers == 0)
+            batchDone.notify_one();
+    }
+}
+
+} // namespace mirras
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mirras
+{
+/*
+    Fixed set of threads that work on batches split into chunks. The thread that submits the batch also
+    takes chunks and waits for all of them to be done, so from the outside a batch behaves just like a loop.
+    Chunks are disjoint ranges, as long as each element is processed independently of the others, the result
+    is the same as the serial one, no matter how many threads there are or in which order chunks run.
+    Only one batch runs at a time, it's meant to be used from the UI thread.
+*/
+class WorkerPool
+{
+public:
+    explicit WorkerPool(unsigned workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls func(first, last) for consecutive ranges covering [0, count), none of them smaller than minChunkSize.
+    // Small batches run entirely on the calling thread
+    template<typename Func>
+    void parallelFor(size_t count, size_t minChunkSize, Func&& func)
+    {
+        parallelForChunks(count, minChunkSize, [&](size_t, size_t first, size_t last) { func(first, last); });
+    }
+
+    // Same as above, but func(chunk, first, last) also gets the index of the range, out of getChunkCount(), so that
+    // each chunk can write to its own output. Gathering the outputs in that order gives the same result as a loop
+    template<typename Func>
+    void parallelForChunks(size_t count, size_t minChunkSize, Func&& func)
+    {
+        size_t chunkCount = getChunkCount(count, minChunkSize);
+
+        if(chunkCount <= 1)
+        {
+            if(count > 0)
+                func(size_t{0}, size_t{0}, count);
+
+            return;
+        }
+
+        size_t chunkSize = count / chunkCount;
+        size_t remainder = count % chunkCount;
+
+        // The first chunks take one extra element each
+        run(chunkCount, [&](size_t chunk)
+        {
+            size_t first = chunk * chunkSize + std::min(chunk, remainder);
+            size_t last = first + chunkSize + (chunk < remainder ? 1 : 0);
+
+            func(chunk, first, last);
+        });
+    }
+
+    // How many ranges a batch is split into
+    size_t getChunkCount(size_t count, size_t minChunkSize) const
+    {
+        size_t chunkCount = std::min(count / std::max(minChunkSize, size_t{1}), (workers.size() + 1) * chunksPerThread);
+
+        if(chunkCount <= 1 || workers.empty())
+            return count > 0 ? 1 : 0;
+
+        return chunkCount;
+    }
+
+    size_t threadCount() const { return workers.size() + 1; }
+
+private:
+    // A few chunks per thread, so that one slower chunk doesn't hold the whole batch
+    static constexpr size_t chunksPerThread = 4;
+
+    void run(size_t chunkCount, const std::function<void(size_t)>& job);
+    size_t runChunks(const std::function<void(size_t)>& job, size_t chunkCount);
+    void workerLoop(std::stop_token stopToken);
+
+    std::mutex mutex;
+    std::condition_variable_any batchReady;
+    std::condition_variable batchDone;
+
+    const std::function<void(size_t)>* currentJob{};
+    size_t currentChunkCount{};
+    std::atomic<size_t> nextChunk{};
+    size_t pendingChunks{};
+    size_t activeWorkers{};
+    uint64_t batchId{};
+
+    std::vector<std::jthread> workers;
+};
+
+inline WorkerPool g_WorkerPool;
+
+} // namespace mirras
\ No newline at end of file